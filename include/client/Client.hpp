@@ -1,17 +1,23 @@
 #ifndef CLIENT_H
 #define CLIENT_H
 
+#include <boost/chrono.hpp>
+#include <memory>
+#include <random>
 #include <string>
+#include <vector>
 
 #include "Common.hpp"
 #include "Generator.hpp"
 #include "RingBuffer.hpp"
+#include "Trace.hpp"
 
 class Client {
 public:
   Client(size_t client_id, RingBuffer<ClientMessage>& buffer,
     size_t running_time, size_t memory_space_size, AccessPattern pattern,
-    double rw_ratio);
+    double zipf_s, double rw_ratio, size_t batch_size,
+    const LoadConfig& load = LoadConfig(), const TraceConfig& trace = TraceConfig());
   void run();
 
 private:
@@ -20,6 +26,32 @@ private:
   size_t running_time_;
   MemoryAccessGenerator generator_;
   double rw_ratio_;
+  size_t batch_size_;
+  size_t memory_space_size_;
+
+  // Open-loop schedule, absolute steady clock ns of the next send
+  LoadConfig load_;
+  Xoshiro256 arrival_rng_;
+  std::exponential_distribution<double> arrival_gap_;
+  double next_send_ns_ = 0.0;
+
+  // Trace capture and replay, null when disabled
+  std::unique_ptr<TraceWriter> recorder_;
+  std::unique_ptr<TraceReader> replayer_;
+  bool replay_timing_;
+  bool has_pending_ = false;
+  TraceRecord pending_{};
+
+  void _pushAll(const ClientMessage* msgs, size_t count);
+  void _generateBatch(std::vector<ClientMessage>& batch, uint64_t now_ns);
+  // Open loop: wait for the next scheduled send, then take every request
+  // that is due. Requests keep their scheduled time even when sent late.
+  void _scheduleBatch(std::vector<ClientMessage>& batch, uint64_t start_ns);
+  static uint64_t _nowNs();
+  static void _waitUntil(uint64_t deadline_ns);
+  // Fill a batch from the trace, false once the trace is exhausted
+  bool _replayBatch(std::vector<ClientMessage>& batch,
+    boost::chrono::steady_clock::time_point start_time);
 };
 
 #endif // CLIENT_H
@@ -2,9 +2,113 @@
 #define GENERATOR_H
 
 #include "Common.hpp"
+#include "Xoshiro.hpp"
 
+#include <cmath>
 #include <random>
-#include <unordered_map>
+
+/**
+ * Seeded bijection on [0, n) used to scatter ranks over the page space.
+ *
+ * A few rounds of add-key, multiply-by-odd and xorshift are each bijective
+ * modulo 2^bits. Values that land in [n, 2^bits) are mapped again (cycle
+ * walking), which takes under two rounds on average.
+ */
+class ScatterPermutation {
+public:
+  ScatterPermutation() : ScatterPermutation(1, 0) {}
+  ScatterPermutation(size_t n, uint64_t seed);
+
+  inline size_t operator()(size_t x) const {
+    do {
+      x = _round(x);
+    } while (x >= n_);
+    return x;
+  }
+
+private:
+  inline uint64_t _round(uint64_t x) const {
+    x = (x + key_[0]) & mask_;
+    x = (x * key_[1]) & mask_;
+    x ^= x >> shift_;
+    x = (x + key_[2]) & mask_;
+    x = (x * key_[3]) & mask_;
+    x ^= x >> shift_;
+    return x;
+  }
+
+  size_t n_;
+  uint64_t mask_;
+  unsigned shift_;
+  uint64_t key_[4]; // key_[1] and key_[3] are odd
+};
+
+/**
+ * Zipf(n, s) rank sampler using rejection-inversion (Hormann & Derflinger).
+ *
+ * Setup is O(1) and needs no per-rank table. A draw inverts the integral of
+ * the continuous hat function and accepts in almost all cases on the first
+ * try. Returns ranks in [0, n), rank 0 being the most popular.
+ */
+class ZipfianSampler {
+public:
+  ZipfianSampler() : ZipfianSampler(1, 1.0) {}
+  ZipfianSampler(size_t n, double s);
+
+  template <typename URBG>
+  inline size_t operator()(URBG& rng) {
+    while (true) {
+      double u = h_integral_n_ + _uniform(rng) * (h_integral_x1_ - h_integral_n_);
+      double x = _hIntegralInverse(u);
+      double k = std::floor(x + 0.5);
+      if (k < 1) {
+        k = 1;
+      }
+      else if (k > n_) {
+        k = n_;
+      }
+      if (k - x <= threshold_ || u >= _hIntegral(k + 0.5) - _h(k)) {
+        return static_cast<size_t>(k) - 1;
+      }
+    }
+  }
+
+private:
+  template <typename URBG>
+  static inline double _uniform(URBG& rng) {
+    // 53 random bits in [0, 1)
+    return (rng() >> 11) * 0x1.0p-53;
+  }
+
+  inline double _h(double x) const { return std::exp(-s_ * std::log(x)); }
+  inline double _hIntegral(double x) const {
+    double log_x = std::log(x);
+    return _expm1OverX((1.0 - s_) * log_x) * log_x;
+  }
+  inline double _hIntegralInverse(double x) const {
+    double t = x * (1.0 - s_);
+    if (t < -1.0) {
+      t = -1.0;
+    }
+    return std::exp(_log1pOverX(t) * x);
+  }
+
+  // log1p(x) / x and expm1(x) / x, stable around x = 0 (the s = 1 case)
+  static inline double _log1pOverX(double x) {
+    return std::fabs(x) > 1e-8 ? std::log1p(x) / x
+      : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+  }
+  static inline double _expm1OverX(double x) {
+    return std::fabs(x) > 1e-8 ? std::expm1(x) / x
+      : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+  }
+
+  double n_;
+  double s_;
+  double h_integral_x1_;
+  double h_integral_n_;
+  double threshold_;
+};
 
 /**
  * Generates memory access patterns according to specified distribution
@@ -12,7 +116,7 @@
 class MemoryAccessGenerator {
 private:
   AccessPattern pattern_;    // Type of access pattern to generate
-  std::mt19937 rng_;         // Random number generator
+  Xoshiro256 rng_;           // Random number generator
   size_t memory_space_size_; // Total memory size to generate accesses for
 
   // Operation type
@@ -21,13 +125,14 @@ private:
   // UNIFORM
   std::uniform_int_distribution<size_t> uniform_dist_;
 
+  // HOT and ZIPF: ranks are scattered over the pages by a permutation
+  ScatterPermutation scatter_;
+
   // HOT
-  std::unordered_map<size_t, size_t> hot_pages_;
   std::uniform_int_distribution<size_t> hot_dist_;
 
   // ZIPF
-  std::vector<double> zipf_prob_;
-  std::discrete_distribution<size_t> zipf_dist_;
+  ZipfianSampler zipf_dist_;
 
 public:
   /**
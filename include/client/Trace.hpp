@@ -0,0 +1,110 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Common.hpp"
+
+/**
+ * Binary access trace.
+ *
+ * Layout: a TraceFileHeader followed by chunks. Each chunk is a
+ * TraceChunkHeader and a payload of LEB128 varints, one or two per record:
+ *   (zigzag(pid - previous pid) << 1) | is_write
+ *   timestamp - previous timestamp (ns), only with TRACE_FLAG_TIMING
+ * Delta state restarts at every chunk from pid 0 and the chunk's base
+ * timestamp, so chunks decode independently from a read-only mapping.
+ */
+struct TraceFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t num_records;
+  uint64_t num_chunks;
+};
+
+struct TraceChunkHeader
+{
+  uint32_t num_records;
+  uint32_t payload_bytes;
+  uint64_t base_timestamp_ns;
+};
+
+constexpr char TRACE_MAGIC[8] = { 'M', 'T', 'T', 'R', 'A', 'C', 'E', '\0' };
+constexpr uint32_t TRACE_VERSION = 1;
+constexpr uint32_t TRACE_FLAG_TIMING = 1;
+constexpr size_t TRACE_CHUNK_BYTES = 64 * 1024;
+
+/**
+ * One access in a trace, timestamp is relative to the client start
+ */
+struct TraceRecord
+{
+  size_t pid;
+  OperationType op_type;
+  uint64_t timestamp_ns;
+};
+
+/**
+ * Appends records to a trace file, one chunk buffered in memory
+ */
+class TraceWriter {
+public:
+  explicit TraceWriter(const std::string& path);
+  ~TraceWriter();
+
+  bool isOpen() const { return file_.is_open(); }
+  void append(size_t pid, OperationType op_type, uint64_t timestamp_ns);
+  // Flush the last chunk and finalize the header
+  void close();
+
+private:
+  void _flushChunk();
+
+  std::ofstream file_;
+  std::string path_;
+  std::vector<uint8_t> payload_;
+  TraceChunkHeader chunk_{};
+  size_t last_pid_ = 0;
+  uint64_t last_timestamp_ns_ = 0;
+  uint64_t num_records_ = 0;
+  uint64_t num_chunks_ = 0;
+};
+
+/**
+ * Streams records out of a memory-mapped trace file
+ */
+class TraceReader {
+public:
+  explicit TraceReader(const std::string& path);
+  ~TraceReader();
+
+  bool isOpen() const { return data_ != nullptr; }
+  bool hasTiming() const { return flags_ & TRACE_FLAG_TIMING; }
+  uint64_t numRecords() const { return num_records_; }
+
+  // Decode the next record, false at the end of the trace or on corruption
+  bool next(TraceRecord& record);
+
+private:
+  bool _openChunk();
+  bool _readVarint(uint64_t& value);
+
+  std::string path_;
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  uint32_t flags_ = 0;
+  uint64_t num_records_ = 0;
+
+  size_t offset_ = 0;       // Next unread byte in the file
+  size_t chunk_end_ = 0;    // End of the current chunk payload
+  uint32_t chunk_left_ = 0; // Records left in the current chunk
+  size_t last_pid_ = 0;
+  uint64_t last_timestamp_ns_ = 0;
+};
+
+#endif // TRACE_H
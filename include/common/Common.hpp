@@ -8,6 +8,8 @@
 
 #include "Logger.hpp"
 
+#define CACHE_LINE_SIZE 64
+
 // ========================== Shared Enums and Structs ==========================
 
 /**
@@ -69,6 +71,35 @@ struct LayerInfo
 
 // ========================== Client-Side Structures ==========================
 
+/**
+ * Inter-arrival process of an open-loop client
+ */
+enum class ArrivalProcess
+{
+  CONSTANT, // Fixed gap of 1 / rate
+  POISSON   // Exponential gaps with mean 1 / rate
+};
+
+/**
+ * Offered load of one client. A zero rate keeps the client closed-loop,
+ * pushing as fast as the queue accepts.
+ */
+struct LoadConfig
+{
+  double target_rate = 0.0; // Requests per second
+  ArrivalProcess arrival = ArrivalProcess::POISSON;
+};
+
+/**
+ * Trace capture or replay for one client, empty paths disable them
+ */
+struct TraceConfig
+{
+  std::string record_path;
+  std::string replay_path;
+  bool replay_timing = false; // Replay at recorded timing instead of full speed
+};
+
 /**
  * Configuration structure for client access pattern and loading settings
  */
@@ -77,6 +108,8 @@ struct ClientConfig
   AccessPattern pattern;
   std::vector<size_t> tier_sizes;
   double zipf_s;
+  LoadConfig load;
+  TraceConfig trace;
 };
 
 /**
@@ -88,9 +121,12 @@ struct ClientMessage
   size_t pid;            // Page identifier to access
   size_t p_offset;       // Access offset inside a page
   OperationType op_type; // Type of operation to perform
+  uint64_t scheduled_ns; // Intended send time (steady clock ns), 0 if unscheduled
 
-  ClientMessage(size_t client_id, size_t pid, size_t p_offset, OperationType op_type)
-    : client_id(client_id), pid(pid), p_offset(p_offset), op_type(op_type) {
+  ClientMessage(size_t client_id, size_t pid, size_t p_offset, OperationType op_type,
+    uint64_t scheduled_ns = 0)
+    : client_id(client_id), pid(pid), p_offset(p_offset), op_type(op_type),
+    scheduled_ns(scheduled_ns) {
   }
 
   std::string toString() const
@@ -104,6 +140,83 @@ struct ClientMessage
 
 // ========================== Server-Side Structures ==========================
 
+/**
+ * Where tier memory lives: real NUMA nodes, or regions of local memory with
+ * an injected per-tier cost model
+ */
+enum class TierBackendType
+{
+  NUMA,
+  EMULATED
+};
+
+/**
+ * Initial content written to every tier at startup
+ */
+enum class ContentType
+{
+  ZERO,    // All zero bytes
+  RANDOM,  // Pseudo-random bytes
+  PATTERN  // Each 8-byte word holds its tier and offset, cheap to verify
+};
+
+/**
+ * Where page hotness comes from
+ */
+enum class HotnessSource
+{
+  SOFTWARE,   // Counters updated by every request the server handles
+  IDLE_BITMAP // Kernel accessed bits sampled once per scan round
+};
+
+/**
+ * Granularity of hotness tracking, classification and migration
+ */
+enum class MigrationUnit
+{
+  PAGE,  // Every 4 KB page on its own
+  REGION // 2 MB regions, mixed regions fall back to their pages
+};
+
+/**
+ * Which 2 MB ranges of the tiers are advised to use transparent huge pages
+ */
+enum class HugePagePolicy
+{
+  NONE, // No advice, the system THP mode applies
+  ALL,  // MADV_HUGEPAGE on every tier
+  HOT   // MADV_HUGEPAGE on hot dense ranges, MADV_NOHUGEPAGE on cold sparse ones
+};
+
+/**
+ * Millisecond clock for page access timestamps
+ */
+enum class ClockSource
+{
+  STEADY, // CLOCK_MONOTONIC read on every call
+  COARSE, // CLOCK_MONOTONIC_COARSE, last timer tick
+  TICKER  // Value refreshed every millisecond by a background thread
+};
+
+/**
+ * Timer for access latency measurement
+ */
+enum class LatencyTimerSource
+{
+  CLOCK, // clock_gettime(CLOCK_MONOTONIC)
+  TSC    // rdtsc/rdtscp calibrated against CLOCK_MONOTONIC
+};
+
+/**
+ * Tier backend selection and the emulated cost model, indexed by PageLayer
+ */
+struct TierBackendConfig
+{
+  TierBackendType type = TierBackendType::NUMA;
+  size_t latency_ns[3] = { 0, 0, 0 };     // Extra latency per access
+  size_t bandwidth_mbps[3] = { 0, 0, 0 }; // Tier bandwidth in MB/s, 0 is unlimited
+};
+
 /**
  * Configuration structure for server memory tiers
  */
@@ -113,6 +226,17 @@ struct ServerMemoryConfig
   LayerInfo local_numa;
   LayerInfo remote_numa;
   LayerInfo pmem;
+  TierBackendConfig backend;
+  ContentType content = ContentType::RANDOM;
+  size_t init_threads = 0; // Threads filling tier content, 0 uses all CPUs
+  HotnessSource hotness_source = HotnessSource::SOFTWARE;
+  ClockSource clock_source = ClockSource::COARSE;
+  LatencyTimerSource latency_timer = LatencyTimerSource::TSC;
+  uint32_t clock_max_count = 3; // GCLOCK count ceiling of the cache rings, 1 is plain CLOCK
+  MigrationUnit migration_unit = MigrationUnit::PAGE;
+  size_t region_density = 50; // Percent of a region's pages that must back a whole-region move
+  HugePagePolicy huge_page_policy = HugePagePolicy::HOT;
+  size_t huge_page_density = 50; // Percent of a range's pages accessed in a round to back it with a huge page
 };
 
 /**
@@ -147,6 +271,16 @@ struct PolicyConfig
   PolicyVariant config;
   std::string policy_type; // "lru", "frequency", "hybrid"
   size_t scan_interval;
+  size_t scanner_threads;             // Threads scanning disjoint page ranges
+  size_t scan_chunk_size;             // Pages classified between pacing checks
+  size_t scan_rate;                   // Pages per second, 0 spreads a round over scan_interval
+  double scan_cpu_budget;             // Percent of a core the scanner may use
+  size_t half_life_ms;                // Access counts halve every half-life, 0 never
+  bool adaptive_thresholds;           // Derive thresholds from each scan round
+  size_t migration_batch_size;        // Pages per move_pages call
+  size_t migration_flush_interval_ms; // Max time a decision waits in a batch
+  size_t migration_threads;           // Migration worker threads
+  size_t migration_queue_size;        // Bound of the migration job queue
 };
 
 #endif // COMMON_H
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "Common.hpp"
+#include "RingBuffer.hpp"
 #include "cxxopts.hpp"
 
 class ConfigParser {
@@ -16,6 +17,9 @@ public:
 
   // Getters for configuration.
   size_t getBufferSize() const { return buffer_size_; }
+  RingBufferMode getQueueMode() const { return queue_mode_; }
+  size_t getBatchSize() const { return batch_size_; }
+  size_t getManagerThreads() const { return manager_threads_; }
   const size_t getRunningTime() const { return running_time_; }
   const std::vector<ClientConfig>& getClientConfigs() const {
     return client_configs_;
@@ -26,6 +30,7 @@ public:
   const PolicyConfig& getPolicyConfig() const { return policy_config_; }
   const std::string& getLatencyOutputFile() const { return cdf_output_file_; }
   const std::string& getPeriodicMetricFile() const { return periodic_metric_output_file_; }
+  const std::string& getEndToEndLatencyFile() const { return e2e_output_file_; }
   const double& getRwRatio() const { return rw_ratio_; }
   const size_t& getSampleRate() const { return sample_rate_; }
   const bool getUseCacheRing() const { return use_cache_ring_; }
@@ -46,6 +51,9 @@ private:
   bool help_requested_;
 
   size_t buffer_size_;
+  RingBufferMode queue_mode_;
+  size_t batch_size_;
+  size_t manager_threads_;
   size_t running_time_;
   double rw_ratio_;
   size_t sample_rate_;
@@ -57,6 +65,7 @@ private:
 
   std::string cdf_output_file_;
   std::string periodic_metric_output_file_;
+  std::string e2e_output_file_;
 };
 
 #endif // CONFIGPARSER_H
@@ -1,41 +1,193 @@
 #ifndef RING_BUFFER_H
 #define RING_BUFFER_H
 
-#include <boost/circular_buffer.hpp>
-#include <boost/thread/condition_variable.hpp>
-#include <boost/thread/locks.hpp>
-#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
 
+#include "Common.hpp"
+
+/**
+ * Producer model of a ring buffer
+ */
+enum class RingBufferMode
+{
+  MPSC, // Many producers, one consumer (producers claim slots with CAS)
+  SPSC  // One producer, one consumer (plain stores, no RMW)
+};
+
+/**
+ * Bounded lock-free ring buffer with a single consumer.
+ *
+ * Each slot carries a sequence number (Vyukov's bounded queue): a slot at
+ * position pos is free for producers when seq == pos and ready for the
+ * consumer when seq == pos + 1. Capacity is rounded up to a power of two.
+ */
 template <typename T> class RingBuffer {
 public:
-  RingBuffer(size_t capacity) : buf_(capacity) {}
+  RingBuffer(size_t capacity, RingBufferMode mode = RingBufferMode::MPSC)
+    : capacity_(_roundUpPowerOfTwo(capacity)), mask_(capacity_ - 1),
+    mode_(mode), slots_(new Slot[capacity_]) {
+    for (size_t i = 0; i < capacity_; i++) {
+      slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~RingBuffer() {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    while (slots_[pos & mask_].seq.load(std::memory_order_relaxed) == pos + 1) {
+      reinterpret_cast<T*>(&slots_[pos & mask_].storage)->~T();
+      pos++;
+    }
+  }
+
+  RingBuffer(const RingBuffer&) = delete;
+  RingBuffer& operator=(const RingBuffer&) = delete;
 
   bool push(const T& item) {
-    boost::unique_lock<boost::mutex> lock(mutex_);
-    if (buf_.full()) {
-      return false;
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    if (mode_ == RingBufferMode::SPSC) {
+      slot = &slots_[pos & mask_];
+      if (slot->seq.load(std::memory_order_acquire) != pos) {
+        return false;
+      }
+      tail_.store(pos + 1, std::memory_order_relaxed);
     }
-    buf_.push_back(item);
-    not_empty_.notify_one();
+    else {
+      while (true) {
+        slot = &slots_[pos & mask_];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (diff == 0) {
+          if (tail_.compare_exchange_weak(pos, pos + 1,
+            std::memory_order_relaxed)) {
+            break;
+          }
+        }
+        else if (diff < 0) {
+          return false;
+        }
+        else {
+          pos = tail_.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    new (&slot->storage) T(item);
+    slot->seq.store(pos + 1, std::memory_order_release);
     return true;
   }
 
   bool pop(T& item) {
-    boost::unique_lock<boost::mutex> lock(mutex_);
-    if (buf_.empty()) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[pos & mask_];
+    if (slot.seq.load(std::memory_order_acquire) != pos + 1) {
       return false;
     }
-    item = buf_.front();
-    buf_.pop_front();
-    not_full_.notify_one();
+
+    T* stored = reinterpret_cast<T*>(&slot.storage);
+    item = std::move(*stored);
+    stored->~T();
+    slot.seq.store(pos + capacity_, std::memory_order_release);
+    head_.store(pos + 1, std::memory_order_release);
     return true;
   }
 
+  // Push up to count items with a single tail claim, returns number pushed
+  size_t pushBatch(const T* items, size_t count) {
+    if (count == 0) {
+      return 0;
+    }
+
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    size_t claimed;
+    while (true) {
+      // A tail read before other producers' claims can trail a head the
+      // consumer moved past it, reload until the pair is consistent
+      size_t head = head_.load(std::memory_order_acquire);
+      if (static_cast<intptr_t>(pos - head) < 0) {
+        pos = tail_.load(std::memory_order_relaxed);
+        continue;
+      }
+      size_t used = pos - head;
+      if (used >= capacity_) {
+        return 0;
+      }
+      claimed = std::min(count, capacity_ - used);
+
+      if (mode_ == RingBufferMode::SPSC) {
+        tail_.store(pos + claimed, std::memory_order_relaxed);
+        break;
+      }
+      if (tail_.compare_exchange_weak(pos, pos + claimed,
+        std::memory_order_relaxed)) {
+        break;
+      }
+    }
+
+    // The consumer frees slots in order, so every claimed slot is free once
+    // head_ has moved past its previous lap
+    for (size_t i = 0; i < claimed; i++) {
+      Slot& slot = slots_[(pos + i) & mask_];
+      new (&slot.storage) T(items[i]);
+      slot.seq.store(pos + i + 1, std::memory_order_release);
+    }
+    return claimed;
+  }
+
+  // Pop up to max_count ready items, returns number popped
+  size_t popBatch(T* items, size_t max_count) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    size_t popped = 0;
+    while (popped < max_count) {
+      Slot& slot = slots_[(pos + popped) & mask_];
+      if (slot.seq.load(std::memory_order_acquire) != pos + popped + 1) {
+        break;
+      }
+      T* stored = reinterpret_cast<T*>(&slot.storage);
+      items[popped] = std::move(*stored);
+      stored->~T();
+      slot.seq.store(pos + popped + capacity_, std::memory_order_release);
+      popped++;
+    }
+
+    if (popped > 0) {
+      head_.store(pos + popped, std::memory_order_release);
+    }
+    return popped;
+  }
+
+  size_t capacity() const { return capacity_; }
+  RingBufferMode mode() const { return mode_; }
+
 private:
-  boost::circular_buffer<T> buf_;
-  mutable boost::mutex mutex_;
-  boost::condition_variable not_full_;
-  boost::condition_variable not_empty_;
+  struct Slot {
+    std::atomic<size_t> seq;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+  static size_t _roundUpPowerOfTwo(size_t n) {
+    size_t capacity = 1;
+    while (capacity < n) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  const RingBufferMode mode_;
+  std::unique_ptr<Slot[]> slots_;
+
+  // Consumer and producer indices live on separate cache lines
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_{ 0 };
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{ 0 };
 };
 
 #endif // RING_BUFFER_H
@@ -0,0 +1,103 @@
+#ifndef XOSHIRO_HPP
+#define XOSHIRO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/**
+ * SplitMix64 step, used to expand one seed into generator state
+ */
+inline uint64_t splitmix64(uint64_t& state)
+{
+  uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * xoshiro256** (Blackman & Vigna). Small, lock-free per instance, and
+ * usable as a UniformRandomBitGenerator with <random> distributions.
+ */
+class Xoshiro256
+{
+public:
+  using result_type = uint64_t;
+
+  explicit Xoshiro256(uint64_t seed)
+  {
+    for (uint64_t& word : s_)
+    {
+      word = splitmix64(seed);
+    }
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  inline result_type operator()()
+  {
+    uint64_t result = _rotl(s_[1] * 5, 7) * 9;
+    uint64_t t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = _rotl(s_[3], 45);
+    return result;
+  }
+
+private:
+  static inline uint64_t _rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  uint64_t s_[4];
+};
+
+/**
+ * LANES independent xoshiro256+ streams stored as a structure of arrays.
+ * Every step advances all lanes with the same operations, so fill() compiles
+ * to vector code and is limited by store bandwidth rather than the
+ * generator's dependency chain.
+ */
+class Xoshiro256Lanes
+{
+public:
+  static constexpr size_t LANES = 8;
+
+  explicit Xoshiro256Lanes(uint64_t seed)
+  {
+    for (size_t lane = 0; lane < LANES; lane++)
+    {
+      for (size_t i = 0; i < 4; i++)
+      {
+        s_[i][lane] = splitmix64(seed);
+      }
+    }
+  }
+
+  // Fill words with random values, n is rounded down to a multiple of LANES
+  inline void fill(uint64_t* out, size_t n)
+  {
+    for (size_t base = 0; base + LANES <= n; base += LANES)
+    {
+      for (size_t lane = 0; lane < LANES; lane++)
+      {
+        out[base + lane] = s_[0][lane] + s_[3][lane];
+        uint64_t t = s_[1][lane] << 17;
+        s_[2][lane] ^= s_[0][lane];
+        s_[3][lane] ^= s_[1][lane];
+        s_[1][lane] ^= s_[2][lane];
+        s_[0][lane] ^= s_[3][lane];
+        s_[2][lane] ^= t;
+        s_[3][lane] = (s_[3][lane] << 45) | (s_[3][lane] >> 19);
+      }
+    }
+  }
+
+private:
+  alignas(64) uint64_t s_[4][LANES];
+};
+
+#endif // XOSHIRO_HPP
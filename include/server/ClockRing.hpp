@@ -1,43 +1,119 @@
 #ifndef CLOCK_RING_HPP
 #define CLOCK_RING_HPP
 
-#include <cstddef>
 #include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
 #include "common/Logger.hpp"
 
-struct ClockRingNode {
-    size_t page_id;
-    std::atomic<bool> ref_bit;
-    ClockRingNode* prev;
-    ClockRingNode* next;
-
-    ClockRingNode(size_t pid) : page_id(pid), ref_bit(false), prev(nullptr), next(nullptr) {}
-};
-
+/**
+ * Concurrent GCLOCK replacement over a fixed array of slots.
+ *
+ * Each slot has a byte lane, packed 8 to a word: the top bit says the slot
+ * holds a page, the low bits count its accesses up to max_count. The hand
+ * is a slot index and a sweep walks the lanes a word at a time, finding
+ * zero-count pages and decrementing the counts it passes with a few
+ * arithmetic operations per word. A page touched once survives one turn
+ * of the hand, a page at max_count survives max_count turns, so a one-pass
+ * scan through the ring evicts the scanned pages before the hot ones. A
+ * max_count of 1 is plain CLOCK. All storage is allocated by the
+ * constructor, free slots are kept on a lock-free stack.
+ *
+ * Every operation is lock-free and may run from any number of threads.
+ * Marking is a single fetch_add. Evictors advance the hand with a CAS, so
+ * each stretch of the ring is swept by exactly one of them, then claim
+ * their victim with a CAS on its slot state. Slots are never freed, only
+ * reused: each carries a generation that moves on when its page leaves,
+ * and a Handle names slot and generation. An operation on a stale handle
+ * fails instead of touching the slot's next page, and a stale mark at
+ * worst counts an access for a slot that was just reused.
+ */
 class ClockRing {
 public:
-    ClockRing(size_t capacity);
-    ~ClockRing();
+    // Slot and generation of a page in the ring
+    using Handle = uint64_t;
+    static constexpr Handle NO_HANDLE = UINT64_MAX;
+    // Highest max_count, racing marks may overshoot it by one per thread
+    static constexpr uint32_t MAX_COUNT = 32;
+
+    explicit ClockRing(size_t capacity, uint32_t max_count = 1);
 
     // Disable copy
     ClockRing(const ClockRing&) = delete;
     ClockRing& operator=(const ClockRing&) = delete;
 
-    bool insert(size_t page_id, ClockRingNode*& out_ptr);
-    void remove(ClockRingNode*& node_ptr);
-    size_t findEvictionCandidate();
+    // Stores the page's handle to handle before the page can be evicted, so
+    // an evictor always finds it there. New pages start at count zero.
+    bool insert(size_t page_id, std::atomic<Handle>& handle);
+    // False if the page already left, through an eviction or another remove
+    bool remove(Handle handle);
+    // Evict the first zero-count page from the hand on, decrementing the
+    // counts passed over. False if the ring is empty or the sweep found
+    // nothing in max_count + 1 turns, possible only while others keep
+    // marking.
+    bool findEvictionCandidate(size_t& page_id, Handle& handle);
 
-    static void markAccessed(ClockRingNode* node);
+    inline void markAccessed(Handle handle) {
+        if (handle == NO_HANDLE) return;
+        uint32_t slot = _slotOf(handle);
+        std::atomic<uint64_t>& word = lanes_[slot / 8];
+        unsigned shift = (slot % 8) * 8;
+        // Skip the locked write once the count is saturated
+        if (((word.load(std::memory_order_relaxed) >> shift) & COUNT) < max_count_)
+            word.fetch_add(1ULL << shift, std::memory_order_relaxed);
+    }
 
     size_t size() const;
     bool empty() const;
+    size_t capacity() const;
+    uint32_t maxCount() const;
 
 private:
-    ClockRingNode* hand_;
-    size_t size_;
+    // Slot state: generation << 1 | LIVE
+    static constexpr uint32_t LIVE = 1;
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    // Lane layout: OCCUPIED | count
+    static constexpr uint64_t COUNT = 0x7F;
+    static constexpr uint64_t OCCUPIED = 0x80;
+    static constexpr uint64_t LANE_COUNTS = 0x7F7F7F7F7F7F7F7FULL;
+    static constexpr uint64_t LANE_TOPS = 0x8080808080808080ULL;
+
+    static inline uint32_t _slotOf(Handle handle) { return static_cast<uint32_t>(handle); }
+    static inline Handle _handle(uint32_t generation, uint32_t slot) {
+        return (static_cast<Handle>(generation) << 32) | slot;
+    }
+    // Top bit set in every lane of word with a non-zero count. Counts stay
+    // below 0x80, so adding 0x7F to each never carries across lanes.
+    static inline uint64_t _counted(uint64_t word) {
+        return ((word & LANE_COUNTS) + LANE_COUNTS) & LANE_TOPS;
+    }
+    // Decrement the non-zero counts of the lanes whose top bit is in lanes
+    void _decrement(size_t index, uint64_t lanes);
+
+    // Take the page out of a slot whose state is expected, LIVE
+    bool _claim(uint32_t slot, uint32_t expected);
+    // Clear the lane of a claimed slot and free it
+    void _release(uint32_t slot);
+
+    bool _popFree(uint32_t& slot);
+    void _pushFree(uint32_t slot);
+
+    std::vector<std::atomic<size_t>> slot_page_;
+    std::vector<std::atomic<uint32_t>> slot_state_;
+    std::vector<std::atomic<uint64_t>> lanes_;
+
+    // Free slot stack, head is tag << 32 | top slot. The tag changes on every
+    // update, so a pop racing with pop/push/pop of the same slot fails.
+    std::vector<std::atomic<uint32_t>> free_next_;
+    std::atomic<uint64_t> free_head_;
+
+    std::atomic<size_t> hand_;
+    std::atomic<size_t> size_;
     size_t capacity_;
+    uint32_t max_count_;
 };
 
-#endif // CLOCK_RING_HPP
\ No newline at end of file
+#endif // CLOCK_RING_HPP
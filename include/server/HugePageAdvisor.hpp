@@ -0,0 +1,122 @@
+#ifndef HUGE_PAGE_ADVISOR_HPP
+#define HUGE_PAGE_ADVISOR_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "Common.hpp"
+#include "Logger.hpp"
+#include "Utils.hpp"
+
+/**
+ * Chooses which 2 MB ranges of the tier mappings transparent huge pages
+ * back.
+ *
+ * Each round the page table counts every page against the range of the
+ * tier mapping holding its address: whether it was accessed in the round,
+ * and whether it still lives on the mapping's own layer. A range whose
+ * accessed pages reach the density threshold is advised MADV_HUGEPAGE and,
+ * where the kernel has MADV_COLLAPSE, collapsed right away within a budget
+ * of ranges per round instead of waiting for khugepaged. A range
+ * below half the threshold, or holding pages migrated to another layer, is
+ * advised MADV_NOHUGEPAGE: khugepaged leaves it in 4 KB pages, so its
+ * pages migrate one at a time without dragging a whole huge page along.
+ * Ranges in between keep their advice, so a range near the threshold does
+ * not flip every round. Advice is only issued when it changes, adjacent
+ * ranges changing the same way share one madvise call.
+ *
+ * Backing is checked against the AnonHugePages of the tier mappings in
+ * /proc/self/smaps. Advice splits the mappings along range boundaries, so
+ * smaps counts huge pages per run of ranges with the same advice, not per
+ * range. A range is known backed once MADV_COLLAPSE succeeds on it or its
+ * whole run is backed. It stays known backed until its run holds fewer
+ * huge pages than it has known backed ranges. Then which ones were split
+ * is unknown, and the whole run is collapsed again.
+ *
+ * Not thread safe, the scanner drives it once per round.
+ */
+class HugePageAdvisor
+{
+public:
+  enum class Advice : uint8_t
+  {
+    DEFAULT, // Never advised, the system THP mode applies
+    HUGE,    // MADV_HUGEPAGE
+    NO_HUGE  // MADV_NOHUGEPAGE
+  };
+
+  struct TierStats
+  {
+    size_t ranges = 0;
+    size_t huge_ranges = 0;    // Advised MADV_HUGEPAGE
+    size_t no_huge_ranges = 0; // Advised MADV_NOHUGEPAGE
+    size_t backed_ranges = 0;  // Huge page backed ranges among the advised huge
+    size_t huge_pages = 0;     // Huge pages in the whole mapping
+    // This round
+    size_t promoted = 0;
+    size_t demoted = 0;
+    size_t collapsed = 0;
+  };
+
+  explicit HugePageAdvisor(size_t density_percent);
+
+  // Track the mapping of a tier, base aligned to HUGE_PAGE_SIZE
+  void addTier(PageLayer layer, void* base, size_t bytes);
+
+  inline void countPage(void* addr, PageLayer layer, bool accessed)
+  {
+    uintptr_t page = reinterpret_cast<uintptr_t>(addr);
+    for (Tier& tier : tiers_)
+    {
+      if (page - tier.base < tier.bytes)
+      {
+        RangeState& range = tier.ranges[(page - tier.base) / HUGE_PAGE_SIZE];
+        range.accessed += accessed;
+        range.foreign |= layer != tier.layer;
+        return;
+      }
+    }
+  }
+
+  // Advise the ranges from this round's counts, collapse newly promoted
+  // ranges, refresh backing from smaps and start the next round
+  void finishRound();
+
+  const TierStats& stats(PageLayer layer) const;
+  bool collapseSupported() const { return collapse_supported_; }
+
+private:
+  struct RangeState
+  {
+    uint16_t accessed = 0;
+    bool foreign = false;
+    Advice advice = Advice::DEFAULT;
+    bool backed = false;
+  };
+
+  struct Tier
+  {
+    PageLayer layer;
+    uintptr_t base = 0;
+    size_t bytes = 0;
+    std::vector<RangeState> ranges;
+    TierStats stats;
+  };
+
+  // Decide the advice of every range of tier, madvise the changes
+  void _advise(Tier& tier);
+  bool _madvise(Tier& tier, size_t first, size_t end, Advice advice);
+  // MADV_COLLAPSE advised ranges that are not backed yet, within the
+  // round's budget
+  void _collapse(Tier& tier, size_t& budget);
+  // Huge pages of the tier mappings from /proc/self/smaps
+  void _readBacking();
+  void _countRun(uintptr_t start, uintptr_t end, size_t huge_kb);
+
+  size_t promote_pages_;
+  size_t demote_pages_;
+  bool collapse_supported_ = true;
+  std::vector<Tier> tiers_;
+};
+
+#endif // HUGE_PAGE_ADVISOR_HPP
@@ -0,0 +1,57 @@
+#ifndef IDLE_PAGE_TRACKER_HPP
+#define IDLE_PAGE_TRACKER_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Common.hpp"
+#include "Logger.hpp"
+#include "Utils.hpp"
+
+/**
+ * Samples hardware accessed bits through the kernel idle page tracking
+ * interface.
+ *
+ * /proc/self/pagemap translates a virtual page to its frame number and
+ * /sys/kernel/mm/page_idle/bitmap holds one idle bit per frame. Setting a
+ * frame's bit clears the accessed bit in its PTEs, the kernel clears the
+ * idle bit again once the MMU marks the page accessed. A sample reads the
+ * bits and re-arms them, so each page reports whether it was touched since
+ * the previous sample, no matter who touched it.
+ *
+ * Needs CONFIG_IDLE_PAGE_TRACKING and CAP_SYS_ADMIN, otherwise pagemap
+ * hides frame numbers and available() is false.
+ */
+class IdlePageTracker
+{
+public:
+  IdlePageTracker();
+  ~IdlePageTracker();
+
+  bool available() const { return pagemap_fd_ >= 0 && bitmap_fd_ >= 0; }
+
+  // accessed[i] is set if pages[i] was referenced since the previous
+  // sample. Pages that are not resident report not accessed.
+  void sample(const std::vector<void*>& pages, std::vector<uint8_t>& accessed);
+
+private:
+  // Frame number of a resident page, 0 if it is not resident
+  uint64_t _frameOf(uintptr_t vpn);
+  void _close();
+
+  int pagemap_fd_ = -1;
+  int bitmap_fd_ = -1;
+
+  // pagemap entries of a run of adjacent virtual pages
+  std::vector<uint64_t> pagemap_window_;
+  uintptr_t window_start_ = 0;
+  size_t window_count_ = 0;
+
+  // (frame, index into pages) sorted by frame to batch bitmap reads
+  std::vector<std::pair<uint64_t, size_t>> frames_;
+  std::vector<uint64_t> bitmap_words_;
+  std::vector<uint64_t> idle_mask_;
+};
+
+#endif // IDLE_PAGE_TRACKER_HPP
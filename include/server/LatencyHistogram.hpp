@@ -0,0 +1,193 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+/**
+ * Log-linear bucket layout shared by histograms and their snapshots.
+ *
+ * Values below 2^SUB_BUCKET_BITS get one bucket each. Above that, every
+ * power of two is split into 2^(SUB_BUCKET_BITS - 1) linear sub-buckets,
+ * so a bucket's width is at most 1/128 of its value (< 0.8% error).
+ */
+struct HistogramLayout
+{
+  static constexpr unsigned SUB_BUCKET_BITS = 8;
+  static constexpr uint64_t SUB_BUCKET_COUNT = 1ULL << SUB_BUCKET_BITS;
+  static constexpr uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT >> 1;
+  static constexpr size_t BUCKET_COUNT =
+    (64 - SUB_BUCKET_BITS) * SUB_BUCKET_HALF + SUB_BUCKET_COUNT;
+
+  static inline size_t bucketIndex(uint64_t value)
+  {
+    if (value < SUB_BUCKET_COUNT)
+    {
+      return static_cast<size_t>(value);
+    }
+    unsigned shift = (63 - __builtin_clzll(value)) - (SUB_BUCKET_BITS - 1);
+    return shift * SUB_BUCKET_HALF + (value >> shift);
+  }
+
+  // Lowest value that maps to a bucket
+  static inline uint64_t bucketLowerBound(size_t index)
+  {
+    if (index < SUB_BUCKET_COUNT)
+    {
+      return index;
+    }
+    uint64_t shift = index / SUB_BUCKET_HALF - 1;
+    return (index - shift * SUB_BUCKET_HALF) << shift;
+  }
+
+  // Representative value reported for a bucket
+  static inline uint64_t bucketMidpoint(size_t index)
+  {
+    if (index < SUB_BUCKET_COUNT)
+    {
+      return index;
+    }
+    uint64_t shift = index / SUB_BUCKET_HALF - 1;
+    return bucketLowerBound(index) + ((1ULL << shift) >> 1);
+  }
+};
+
+/**
+ * Plain, non-atomic copy of a histogram used for reporting
+ */
+struct HistogramSnapshot
+{
+  std::vector<uint64_t> counts;
+  uint64_t count = 0;
+  uint64_t sum = 0;
+  uint64_t min = std::numeric_limits<uint64_t>::max();
+  uint64_t max = 0;
+
+  HistogramSnapshot() : counts(HistogramLayout::BUCKET_COUNT, 0) {}
+
+  void merge(const HistogramSnapshot& other)
+  {
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+      counts[i] += other.counts[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+  }
+
+  // Samples recorded between an earlier snapshot and this one. Min and max
+  // are recovered from the occupied buckets.
+  HistogramSnapshot delta(const HistogramSnapshot& earlier) const
+  {
+    HistogramSnapshot result;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+      result.counts[i] = counts[i] - earlier.counts[i];
+      if (result.counts[i] > 0)
+      {
+        result.min = std::min(result.min, HistogramLayout::bucketLowerBound(i));
+        result.max = std::max(result.max, HistogramLayout::bucketMidpoint(i));
+      }
+    }
+    result.count = count - earlier.count;
+    result.sum = sum - earlier.sum;
+    return result;
+  }
+
+  // Value at quantile q in [0, 1]
+  uint64_t percentile(double q) const
+  {
+    if (count == 0)
+    {
+      return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count));
+    rank = std::min(std::max<uint64_t>(rank, 1), count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+      seen += counts[i];
+      if (seen >= rank)
+      {
+        return std::min(std::max(HistogramLayout::bucketMidpoint(i), min), max);
+      }
+    }
+    return max;
+  }
+
+  double mean() const
+  {
+    return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+  }
+};
+
+/**
+ * Lock-free log-linear latency histogram.
+ *
+ * Writers only do relaxed atomic adds, so any number of threads may record
+ * concurrently. Snapshots are taken without stopping writers and may be off
+ * by the samples recorded while the copy runs.
+ */
+class LatencyHistogram
+{
+public:
+  LatencyHistogram() : counts_(new std::atomic<uint64_t>[HistogramLayout::BUCKET_COUNT]())
+  {
+  }
+
+  inline void record(uint64_t value)
+  {
+    counts_[HistogramLayout::bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    // Min and max rarely change, avoid the RMW when they do not
+    uint64_t current = min_.load(std::memory_order_relaxed);
+    while (value < current && !min_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+    current = max_.load(std::memory_order_relaxed);
+    while (value > current && !max_.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  HistogramSnapshot snapshot() const
+  {
+    HistogramSnapshot result;
+    for (size_t i = 0; i < HistogramLayout::BUCKET_COUNT; i++)
+    {
+      result.counts[i] = counts_[i].load(std::memory_order_relaxed);
+    }
+    result.count = count_.load(std::memory_order_relaxed);
+    result.sum = sum_.load(std::memory_order_relaxed);
+    result.min = min_.load(std::memory_order_relaxed);
+    result.max = max_.load(std::memory_order_relaxed);
+    return result;
+  }
+
+  void reset()
+  {
+    for (size_t i = 0; i < HistogramLayout::BUCKET_COUNT; i++)
+    {
+      counts_[i].store(0, std::memory_order_relaxed);
+    }
+    count_ = 0;
+    sum_ = 0;
+    min_ = std::numeric_limits<uint64_t>::max();
+    max_ = 0;
+  }
+
+private:
+  std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+  std::atomic<uint64_t> count_{ 0 };
+  std::atomic<uint64_t> sum_{ 0 };
+  std::atomic<uint64_t> min_{ std::numeric_limits<uint64_t>::max() };
+  std::atomic<uint64_t> max_{ 0 };
+};
+
+#endif // LATENCY_HISTOGRAM_HPP
@@ -1,23 +1,25 @@
 #ifndef METRICS_H
 #define METRICS_H
 
+#include <array>
 #include <atomic>
-#include <boost/accumulators/accumulators.hpp>
-#include <boost/accumulators/statistics/extended_p_square.hpp>
-#include <boost/accumulators/statistics/max.hpp>
-#include <boost/accumulators/statistics/mean.hpp>
-#include <boost/accumulators/statistics/min.hpp>
-#include <boost/accumulators/statistics/stats.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
 #include <cstdint>
 #include <fstream>
+#include <memory>
+#include <vector>
 
 #include "Common.hpp"
+#include "LatencyHistogram.hpp"
 #include "Logger.hpp"
 
-namespace acc = boost::accumulators;
-
 /**
- * Memory metrics collector with atomic counters
+ * Memory metrics collector.
+ *
+ * Event counters live in per-thread shards, each on its own cache lines, so
+ * the access path never writes a line shared with another thread. Readers
+ * sum the shards when they report.
  */
 class Metrics {
 public:
@@ -33,22 +35,46 @@ public:
   Metrics& operator=(Metrics&&) = delete;
 
   // Access counters
-  inline void incrementLocalAccess() { local_access_count_++; }
-  inline void incrementRemoteAccess() { remote_access_count_++; }
-  inline void incrementPmemAccess() { pmem_access_count_++; }
+  inline void incrementLocalAccess() { _add(LOCAL_ACCESS, 1); }
+  inline void incrementRemoteAccess() { _add(REMOTE_ACCESS, 1); }
+  inline void incrementPmemAccess() { _add(PMEM_ACCESS, 1); }
 
   // Migration counters
-  inline void incrementLocalToRemote() { local_to_remote_count_++; }
-  inline void incrementRemoteToLocal() { remote_to_local_count_++; }
-  inline void incrementPmemToRemote() { pmem_to_remote_count_++; }
-  inline void incrementRemoteToPmem() { remote_to_pmem_count_++; }
-  inline void incrementLocalToPmem() { local_to_pmem_count_++; }
-  inline void incrementPmemToLocal() { pmem_to_local_count_++; }
+  inline void incrementLocalToRemote() { _add(LOCAL_TO_REMOTE, 1); }
+  inline void incrementRemoteToLocal() { _add(REMOTE_TO_LOCAL, 1); }
+  inline void incrementPmemToRemote() { _add(PMEM_TO_REMOTE, 1); }
+  inline void incrementRemoteToPmem() { _add(REMOTE_TO_PMEM, 1); }
+  inline void incrementLocalToPmem() { _add(LOCAL_TO_PMEM, 1); }
+  inline void incrementPmemToLocal() { _add(PMEM_TO_LOCAL, 1); }
+
+  // Migration syscalls, counted separately from migrated pages
+  inline void incrementMigrationSyscall() { _add(MIGRATION_SYSCALL, 1); }
+  inline void incrementMigrationFailure() { _add(MIGRATION_FAILURE, 1); }
+
+  // Migration engine queue depth and enqueue-to-completion latency
+  inline void setMigrationQueueDepth(uint64_t depth) {
+    migration_queue_depth_.store(depth, std::memory_order_relaxed);
+  }
+  inline void recordMigrationLatency(uint64_t latency_ns) {
+    _add(MIGRATION_LATENCY_TOTAL, latency_ns);
+    _add(MIGRATION_LATENCY_COUNT, 1);
+    uint64_t max = migration_latency_max_.load(std::memory_order_relaxed);
+    while (latency_ns > max &&
+      !migration_latency_max_.compare_exchange_weak(max, latency_ns)) {
+    }
+  }
 
   // Latency recording
   inline void recordAccessLatency(uint64_t latency_ns) {
-    access_latency_(latency_ns);
-    total_latency_ += latency_ns;
+    CounterShard* shard = _localShard();
+    shard->access_latency.record(latency_ns);
+    _add(shard, TOTAL_LATENCY, latency_ns);
+  }
+
+  // Open-loop latency from a request's scheduled send time to completion,
+  // includes time spent queued behind earlier requests
+  inline void recordEndToEndLatency(uint64_t latency_ns) {
+    _localShard()->end_to_end_latency.record(latency_ns);
   }
 
   // Periodically latency calculation
@@ -58,6 +84,8 @@ public:
   void printMetricsThreeTiers() const;
   void printMetricsTwoTiers() const;
   void outputLatencyCDFToFile(const std::string& filename) const;
+  // Written only when requests carried a scheduled send time
+  void outputEndToEndCDFToFile(const std::string& filename) const;
 
   // Reset all counters
   void reset();
@@ -65,37 +93,78 @@ public:
 private:
   Metrics() = default; // Private constructor for singleton
 
-  // Access counters
-  std::atomic<uint64_t> local_access_count_{ 0 };
-  std::atomic<uint64_t> remote_access_count_{ 0 };
-  std::atomic<uint64_t> pmem_access_count_{ 0 };
+  enum Counter : size_t
+  {
+    LOCAL_ACCESS,
+    REMOTE_ACCESS,
+    PMEM_ACCESS,
+    LOCAL_TO_REMOTE,
+    REMOTE_TO_LOCAL,
+    PMEM_TO_REMOTE,
+    REMOTE_TO_PMEM,
+    LOCAL_TO_PMEM,
+    PMEM_TO_LOCAL,
+    MIGRATION_SYSCALL,
+    MIGRATION_FAILURE,
+    MIGRATION_LATENCY_TOTAL,
+    MIGRATION_LATENCY_COUNT,
+    TOTAL_LATENCY,
+    NUM_COUNTERS
+  };
+
+  using CounterSnapshot = std::array<uint64_t, NUM_COUNTERS>;
+
+  // Counters written by a single thread. Aligned so neighbouring shards
+  // never share a cache line.
+  struct alignas(CACHE_LINE_SIZE) CounterShard
+  {
+    std::atomic<uint64_t> counters[NUM_COUNTERS] = {};
+    LatencyHistogram access_latency;
+    LatencyHistogram end_to_end_latency;
+  };
+
+  // Shard of the calling thread, registered on first use. Shards are owned
+  // by Metrics so counts survive the threads that produced them.
+  inline CounterShard* _localShard() {
+    thread_local CounterShard* shard = _registerShard();
+    return shard;
+  }
 
-  // Migration counters
-  std::atomic<uint64_t> local_to_remote_count_{ 0 };
-  std::atomic<uint64_t> remote_to_local_count_{ 0 };
-  std::atomic<uint64_t> pmem_to_remote_count_{ 0 };
-  std::atomic<uint64_t> remote_to_pmem_count_{ 0 };
-  std::atomic<uint64_t> local_to_pmem_count_{ 0 };
-  std::atomic<uint64_t> pmem_to_local_count_{ 0 };
+  // Only the owning thread writes a shard, a plain load and store is enough
+  static inline void _add(CounterShard* shard, Counter counter, uint64_t value) {
+    std::atomic<uint64_t>& slot = shard->counters[counter];
+    slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+  inline void _add(Counter counter, uint64_t value) { _add(_localShard(), counter, value); }
+
+  CounterShard* _registerShard();
+  CounterSnapshot _aggregateCounters() const;
+  HistogramSnapshot _aggregateLatency(
+    LatencyHistogram CounterShard::* histogram = &CounterShard::access_latency) const;
+
+  mutable boost::mutex shards_mutex_;
+  std::vector<std::unique_ptr<CounterShard>> shards_;
+
+  // Gauges shared by all threads
+  std::atomic<uint64_t> migration_queue_depth_{ 0 };
+  std::atomic<uint64_t> migration_latency_max_{ 0 };
 
   // Latency tracking
   static constexpr double probabilities[] = { 0.1, 0.2, 0.3, 0.4, 0.5,
-                                             0.6, 0.7, 0.8, 0.9 };
-
-  using AccumulatorType = acc::accumulator_set<
-    uint64_t, acc::stats<acc::tag::mean, acc::tag::min, acc::tag::max,
-    acc::tag::extended_p_square>>;
-  AccumulatorType access_latency_{ acc::tag::extended_p_square::probabilities =
-                                      probabilities };
+                                             0.6, 0.7, 0.8, 0.9,
+                                             0.99, 0.999, 0.9999 };
 
-  // Total latency tracking for throughput calculation
-  std::atomic<uint64_t> total_latency_{ 0 };
+  void _printLatency(const HistogramSnapshot& latency, const char* title = "Access Latency (ns):") const;
+  void _writeCDF(const HistogramSnapshot& latency, const std::string& filename) const;
 
   // Periodical metrics
   uint64_t last_period_local_access_count_{ 0 };
   uint64_t last_period_remote_access_count_{ 0 };
   uint64_t last_period_pmem_access_count_{ 0 };
   uint64_t last_period_latency_{ 0 };
+  HistogramSnapshot last_period_latency_snapshot_;
+  HistogramSnapshot last_period_e2e_snapshot_;
+  int_least64_t last_period_interval_{ 0 };
 
   uint64_t last_period_local_to_remote_count_{ 0 };
   uint64_t last_period_remote_to_local_count_{ 0 };
@@ -103,6 +172,10 @@ private:
   uint64_t last_period_remote_to_pmem_count_{ 0 };
   uint64_t last_period_local_to_pmem_count_{ 0 };
   uint64_t last_period_pmem_to_local_count_{ 0 };
+  uint64_t last_period_migration_syscall_count_{ 0 };
+  uint64_t last_period_migration_failure_count_{ 0 };
+  uint64_t last_period_migration_latency_total_{ 0 };
+  uint64_t last_period_migration_latency_count_{ 0 };
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,124 @@
+#ifndef MIGRATION_ENGINE_HPP
+#define MIGRATION_ENGINE_HPP
+
+#include <boost/chrono.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/unordered_map.hpp>
+#include <deque>
+#include <vector>
+
+#include "Common.hpp"
+#include "Logger.hpp"
+#include "Metrics.hpp"
+#include "PageTable.hpp"
+
+/**
+ * A request to move one page, or one region in region mode, to a target
+ * layer
+ */
+struct MigrationJob
+{
+  size_t page_id; // Region id for region jobs
+  PageLayer source_layer;
+  PageLayer target_layer;
+  boost::chrono::steady_clock::time_point enqueue_time;
+  bool region = false;
+};
+
+/**
+ * Asynchronous migration executor.
+ *
+ * The scanner submits (page, target layer) jobs into a bounded queue and
+ * keeps classifying. Worker threads drain the queue in batches and move
+ * each batch with one migratePages call per target layer. A page has at most
+ * one job queued or in flight: a newer decision for a queued page replaces
+ * its target, a decision for another target while the page is in flight is
+ * rejected. When the queue is full, submit blocks until a worker makes room.
+ *
+ * Submit also arbitrates capacity across concurrent scanner threads: a job
+ * is admitted only while the target layer's free slots, plus the slots
+ * that admitted jobs leaving it will free, cover the jobs already admitted
+ * into it. Jobs count until their batch completes, so the check errs on
+ * the side of rejecting. A region job counts as its number of pages.
+ */
+class MigrationEngine
+{
+public:
+  MigrationEngine(PageTable* page_table, size_t num_workers, size_t queue_capacity,
+    size_t batch_size, size_t flush_interval_ms);
+  ~MigrationEngine();
+
+  // Start and join worker threads
+  void start();
+  void join();
+
+  // Queue a migration job, blocks while the queue is full. Returns false
+  // on shutdown, when the target layer has no room for it, or when the
+  // page is already moving to another layer.
+  bool submit(size_t page_id, PageLayer source_layer, PageLayer target_layer);
+  // Same for a whole region, source_layer is its majority layer
+  bool submitRegion(size_t region, PageLayer source_layer, PageLayer target_layer);
+
+  // Jobs rejected for lack of room or a page in flight since the last call
+  size_t takeRejected();
+
+  // Ask workers to drain queued jobs without waiting for a full batch
+  void flush();
+
+  void signalShutdown();
+
+  size_t queueDepth();
+
+private:
+  enum class JobState { QUEUED, IN_FLIGHT };
+
+  struct PendingJob
+  {
+    JobState state;
+    PageLayer source_layer;
+    PageLayer target_layer;
+    size_t pages;
+  };
+
+  // Pages and regions share pending_, region keys have the top bit set
+  static constexpr size_t REGION_KEY = size_t(1) << 63;
+  static size_t _key(const MigrationJob& job)
+  {
+    return job.region ? job.page_id | REGION_KEY : job.page_id;
+  }
+
+  bool _submit(MigrationJob job, size_t pages);
+
+  // Admission check and accounting, queue_mutex_ held. A replaced job's
+  // share is swapped for the new one only if the new one is admitted.
+  bool _admit(PageLayer source_layer, PageLayer target_layer, size_t pages,
+    const PendingJob* replaced = nullptr);
+  void _release(PageLayer source_layer, PageLayer target_layer, size_t pages);
+
+  void _runWorker(size_t worker_id);
+  void _executeBatch(std::vector<MigrationJob>& batch);
+
+  PageTable* page_table_;
+  size_t num_workers_;
+  size_t queue_capacity_;
+  size_t batch_size_;
+  boost::chrono::milliseconds flush_interval_;
+
+  boost::mutex queue_mutex_;
+  boost::condition_variable not_empty_;
+  boost::condition_variable not_full_;
+  std::deque<MigrationJob> queue_;
+  boost::unordered_map<size_t, PendingJob> pending_;
+  // Admitted jobs moving into / out of each layer, indexed by PageLayer
+  size_t inbound_[3] = { 0, 0, 0 };
+  size_t outbound_[3] = { 0, 0, 0 };
+  size_t rejected_ = 0;
+  bool flush_requested_ = false;
+  bool shutdown_flag_ = false;
+
+  std::vector<boost::thread> workers_;
+};
+
+#endif // MIGRATION_ENGINE_HPP
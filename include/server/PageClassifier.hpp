@@ -0,0 +1,101 @@
+#ifndef PAGE_CLASSIFIER_HPP
+#define PAGE_CLASSIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Common.hpp"
+
+// Pages classified together, one bit each in the result masks
+#define CLASSIFY_BLOCK_SIZE 64
+
+/**
+ * Metadata of up to CLASSIFY_BLOCK_SIZE consecutive pages. Entries past
+ * size are ignored.
+ */
+struct alignas(CACHE_LINE_SIZE) ClassifyBlock
+{
+  uint32_t age_ms[CLASSIFY_BLOCK_SIZE]; // Time since last access
+  uint32_t count[CLASSIFY_BLOCK_SIZE];  // Decayed access count
+  uint8_t layer[CLASSIFY_BLOCK_SIZE];   // PageLayer
+  size_t size = 0;
+};
+
+/**
+ * Migration decisions for a block, bit i is page i
+ */
+struct MigrationMasks
+{
+  uint64_t to_local;
+  uint64_t to_remote;
+  uint64_t to_pmem;
+};
+
+enum class ClassifierIsa
+{
+  SCALAR,
+  AVX2,
+  AVX512
+};
+
+/**
+ * Batch page classifier.
+ *
+ * Every policy is a function of two tests per side: recency (age against
+ * the hot or cold threshold) and frequency (count against the hot or cold
+ * count). The policy type and hybrid weights are resolved once into a
+ * truth table over those two tests, shared by both sides, so classifying
+ * a block is four vector compares into bitmasks plus a few mask
+ * operations, with no clock reads or policy lookups per page. A page that
+ * is both hot and cold is hot, as with the per-page classifier.
+ */
+class PageClassifier
+{
+public:
+  // Thresholds are copied, build a new classifier when they change
+  PageClassifier(const PolicyConfig& policy, size_t num_tiers, ClassifierIsa isa = bestIsa());
+
+  // Bit i set when page i is hot / cold
+  void classify(const ClassifyBlock& block, uint64_t& hot, uint64_t& cold) const;
+
+  // Target layer of every page that should move
+  MigrationMasks targets(const ClassifyBlock& block) const;
+
+  // Widest instruction set this CPU supports
+  static ClassifierIsa bestIsa();
+  static const char* isaName(ClassifierIsa isa);
+
+private:
+  /**
+   * Per-block test results
+   */
+  struct Predicates
+  {
+    uint64_t recent;     // age <= hot age
+    uint64_t frequent;   // count >= hot count
+    uint64_t stale;      // age >= cold age
+    uint64_t infrequent; // count <= cold count
+    uint64_t local;      // On NUMA_LOCAL
+    uint64_t pmem;       // On PMEM
+  };
+
+  void _predicates(const ClassifyBlock& block, Predicates& result) const;
+  void _predicatesScalar(const ClassifyBlock& block, Predicates& result) const;
+  void _predicatesAvx2(const ClassifyBlock& block, Predicates& result) const;
+  void _predicatesAvx512(const ClassifyBlock& block, Predicates& result) const;
+
+  // Truth table bit (recency << 1 | frequency) set when that outcome
+  // of the two tests classifies the page
+  static uint8_t _truthTable(const PolicyConfig& policy);
+  static uint64_t _combine(uint8_t table, uint64_t recency, uint64_t frequency);
+
+  ClassifierIsa isa_;
+  size_t num_tiers_;
+  uint32_t hot_age_ms_;
+  uint32_t cold_age_ms_;
+  uint32_t hot_count_;
+  uint32_t cold_count_;
+  uint8_t table_;
+};
+
+#endif // PAGE_CLASSIFIER_HPP
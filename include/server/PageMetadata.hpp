@@ -0,0 +1,171 @@
+#ifndef PAGE_METADATA_HPP
+#define PAGE_METADATA_HPP
+
+#include <atomic>
+#include <boost/align/aligned_allocator.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "ClockRing.hpp"
+#include "Common.hpp"
+#include "Timing.hpp"
+
+template <typename T>
+using CacheAlignedVector =
+  std::vector<T, boost::alignment::aligned_allocator<T, CACHE_LINE_SIZE>>;
+
+/**
+ * Page metadata stored as a structure of arrays indexed by page id.
+ *
+ * Page ids are dense in [0, size()), so a lookup is a single indexed load
+ * per field. Timestamps are kept as 32-bit milliseconds relative to the
+ * table epoch, which covers ~49 days of runtime. Without hotness tracking
+ * the recency and frequency fields are not allocated, hotness then lives
+ * in a table indexed by region.
+ */
+class PageMetadataArray
+{
+public:
+  PageMetadataArray() : num_pages_(0), epoch_ms_(nowMs()) {}
+
+  explicit PageMetadataArray(size_t num_pages, bool track_hotness = true)
+    : num_pages_(num_pages), epoch_ms_(nowMs()), page_layer_(num_pages),
+    last_access_time_ms_(track_hotness ? num_pages : 0),
+    access_cnt_(track_hotness ? num_pages : 0), ring_handle_(num_pages) {
+    for (size_t i = 0; i < num_pages; i++)
+    {
+      ring_handle_[i].store(ClockRing::NO_HANDLE, std::memory_order_relaxed);
+    }
+  }
+
+  size_t size() const { return num_pages_; }
+
+  // Layer
+  inline PageLayer layer(size_t page_id) const
+  {
+    return static_cast<PageLayer>(page_layer_[page_id].load(std::memory_order_relaxed));
+  }
+  inline void setLayer(size_t page_id, PageLayer layer)
+  {
+    page_layer_[page_id].store(static_cast<uint8_t>(layer), std::memory_order_relaxed);
+  }
+
+  // Recency, returned as absolute steady clock milliseconds
+  inline uint64_t lastAccessTimeMs(size_t page_id) const
+  {
+    return epoch_ms_ + last_access_time_ms_[page_id].load(std::memory_order_relaxed);
+  }
+  inline void setLastAccessTimeMs(size_t page_id, uint64_t now_ms)
+  {
+    last_access_time_ms_[page_id].store(static_cast<uint32_t>(now_ms - epoch_ms_),
+      std::memory_order_relaxed);
+  }
+
+  // Frequency, an access count that halves every half-life. The count and
+  // the epoch it was last aged in share one word (epoch in the high 16
+  // bits, count in the low 16), so aging is lazy: a page catches up on
+  // the halvings it missed whenever it is touched or scanned.
+  inline uint32_t accessCount(size_t page_id, uint64_t now_ms) const
+  {
+    return _decay(access_cnt_[page_id].load(std::memory_order_relaxed), _epoch(now_ms))
+      & COUNT_MASK;
+  }
+  inline void incrementAccessCount(size_t page_id, uint64_t now_ms)
+  {
+    uint32_t epoch = _epoch(now_ms);
+    std::atomic<uint32_t>& packed = access_cnt_[page_id];
+    uint32_t current = packed.load(std::memory_order_relaxed);
+    uint32_t aged;
+    do
+    {
+      aged = _decay(current, epoch);
+      if ((aged & COUNT_MASK) != COUNT_MASK)
+      {
+        aged++;
+      }
+    } while (!packed.compare_exchange_weak(current, aged, std::memory_order_relaxed));
+  }
+  // Store the decayed count back, returns it
+  inline uint32_t ageAccessCount(size_t page_id, uint64_t now_ms)
+  {
+    uint32_t epoch = _epoch(now_ms);
+    std::atomic<uint32_t>& packed = access_cnt_[page_id];
+    uint32_t current = packed.load(std::memory_order_relaxed);
+    uint32_t aged = _decay(current, epoch);
+    while (aged != current &&
+      !packed.compare_exchange_weak(current, aged, std::memory_order_relaxed))
+    {
+      aged = _decay(current, epoch);
+    }
+    return aged & COUNT_MASK;
+  }
+  inline void resetAccessCount(size_t page_id)
+  {
+    access_cnt_[page_id].store(0, std::memory_order_relaxed);
+  }
+  // 0 keeps lifetime counts. Set before the table is shared.
+  void setHalfLifeMs(uint64_t half_life_ms) { half_life_ms_ = half_life_ms; }
+
+  // Cache ring handle, ClockRing::NO_HANDLE when the page is not in the ring
+  inline ClockRing::Handle ringHandle(size_t page_id) const
+  {
+    return ring_handle_[page_id].load(std::memory_order_relaxed);
+  }
+  // Where ClockRing::insert publishes the handle
+  inline std::atomic<ClockRing::Handle>& ringHandleSlot(size_t page_id)
+  {
+    return ring_handle_[page_id];
+  }
+  inline ClockRing::Handle exchangeRingHandle(size_t page_id, ClockRing::Handle handle)
+  {
+    return ring_handle_[page_id].exchange(handle);
+  }
+  // Clear the handle if it is still expected, a newer one stays
+  inline void clearRingHandle(size_t page_id, ClockRing::Handle expected)
+  {
+    ring_handle_[page_id].compare_exchange_strong(expected, ClockRing::NO_HANDLE);
+  }
+
+  // Bytes of metadata held per page
+  static constexpr size_t bytesPerPage(bool track_hotness = true)
+  {
+    return sizeof(uint8_t) + (track_hotness ? sizeof(uint32_t) + sizeof(uint32_t) : 0) +
+      sizeof(ClockRing::Handle);
+  }
+
+  // Timestamp clock shared by every metadata reader and writer
+  static uint64_t nowMs() { return CoarseClock::nowMs(); }
+
+private:
+  static constexpr uint32_t COUNT_BITS = 16;
+  static constexpr uint32_t COUNT_MASK = (1u << COUNT_BITS) - 1;
+
+  inline uint32_t _epoch(uint64_t now_ms) const
+  {
+    return half_life_ms_
+      ? static_cast<uint32_t>((now_ms - epoch_ms_) / half_life_ms_) & COUNT_MASK : 0;
+  }
+  // Age a packed count to epoch. A caller holding a stale clock may see a
+  // newer stored epoch, the value is then already current.
+  static inline uint32_t _decay(uint32_t packed, uint32_t epoch)
+  {
+    uint32_t elapsed = (epoch - (packed >> COUNT_BITS)) & COUNT_MASK;
+    if (elapsed == 0 || elapsed > COUNT_MASK / 2)
+    {
+      return packed;
+    }
+    uint32_t count = elapsed >= COUNT_BITS ? 0 : (packed & COUNT_MASK) >> elapsed;
+    return (epoch << COUNT_BITS) | count;
+  }
+
+  size_t num_pages_;
+  uint64_t epoch_ms_;
+  uint64_t half_life_ms_ = 0;
+
+  CacheAlignedVector<std::atomic<uint8_t>> page_layer_;
+  CacheAlignedVector<std::atomic<uint32_t>> last_access_time_ms_;
+  CacheAlignedVector<std::atomic<uint32_t>> access_cnt_;
+  CacheAlignedVector<std::atomic<ClockRing::Handle>> ring_handle_;
+};
+
+#endif // PAGE_METADATA_HPP
@@ -1,48 +1,42 @@
 #ifndef PAGETABLE_H
 #define PAGETABLE_H
 
+#include <array>
 #include <atomic>
+#include <boost/chrono.hpp>
+#include <boost/thread/lock_guard.hpp>
 #include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/thread/shared_mutex.hpp>
-#include <boost/unordered_map.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/unordered_set.hpp>
 #include <tuple>
 #include <vector>
 
 #include "ClockRing.hpp"
 #include "Common.hpp"
+#include "HugePageAdvisor.hpp"
+#include "IdlePageTracker.hpp"
 #include "Logger.hpp"
 #include "Metrics.hpp"
+#include "PageClassifier.hpp"
+#include "PageMetadata.hpp"
+#include "TierBackend.hpp"
 #include "Utils.hpp"
+#include "Xoshiro.hpp"
 
-#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+// Pages in a region, the unit of tracking and migration in region mode
+#define REGION_PAGES (HUGE_PAGE_SIZE / PAGE_SIZE)
+#define REGION_WORDS (REGION_PAGES / 64)
 
-struct PageMetadata
+/**
+ * Pages accessed since the last scan in up to CLASSIFY_BLOCK_SIZE regions,
+ * bit j of bits[i] is page j of region i
+ */
+struct RegionTouchBlock
 {
-  std::atomic<PageLayer> page_layer;
-  std::atomic<uint64_t> last_access_time_ms;
-  std::atomic<uint32_t> access_cnt;
-  std::atomic<ClockRingNode*> ring_node_ptr;
-
-  PageMetadata(PageLayer layer = PageLayer::NUMA_LOCAL)
-    : page_layer(layer), ring_node_ptr(nullptr)
-  {
-    auto now = boost::chrono::steady_clock::now();
-    auto duration = now.time_since_epoch();
-    auto ms =
-      boost::chrono::duration_cast<boost::chrono::microseconds>(duration)
-      .count();
-    last_access_time_ms.store(ms);
-  }
-};
-
-struct PageTableEntry
-{
-  void* page_address;
-  PageMetadata metadata;
-
-  PageTableEntry(void* addr = 0, PageLayer layer = PageLayer::NUMA_LOCAL)
-    : page_address(addr), metadata(layer) {
-  }
+  uint64_t bits[CLASSIFY_BLOCK_SIZE][REGION_WORDS];
+  uint32_t count[CLASSIFY_BLOCK_SIZE];
 };
 
 class PageTable
@@ -53,27 +47,126 @@ public:
   ~PageTable();
 
   void initPageTable();
+  // Half-life of the access counts of pages and regions, 0 keeps lifetime
+  // counts
+  void setAccessHalfLife(size_t half_life_ms);
 
-  // Read-only operations
+  // Layer, last access time and decayed access count of a page, the
+  // times and counts of its region in region mode
   std::tuple<PageLayer, uint64_t, uint32_t> getPageMetaData(size_t page_id);
-  size_t size() const { return table_.size(); };
-  size_t scanNext();
+  PageLayer pageLayer(size_t page_id) const { return metadata_.layer(page_id); }
+  // Same for count pages from first_page on, as ages relative to now_ms.
+  // Access counts are aged in place like getPageMetaData does.
+  void readBlock(size_t first_page, size_t count, uint64_t now_ms, ClassifyBlock& block);
+  size_t size() const { return metadata_.size(); };
+
+  // Region mode: hotness is tracked per region, a run of up to
+  // REGION_PAGES pages of one client and tier that shares a huge page.
+  // Regions cut short by a segment boundary are partial.
+  bool regionMode() const { return region_mode_; }
+  size_t numRegions() const { return region_start_.empty() ? 0 : region_start_.size() - 1; }
+  size_t regionSize(size_t region) const
+  {
+    return region_start_[region + 1] - region_start_[region];
+  }
+  // Same as readBlock for count regions from first_region on. A region's
+  // layer is the one holding most of its pages. Takes the regions' touched
+  // pages, clearing them for the next round.
+  void readRegionBlock(size_t first_region, size_t count, uint64_t now_ms, ClassifyBlock& block,
+    RegionTouchBlock& touched);
+  // Append the pages of region that moving it to target_layer would move:
+  // pages on slower layers for a promotion, on faster ones for a demotion.
+  // With touched, only the pages whose bit equals want_touched.
+  void selectRegionPages(size_t region, PageLayer target_layer, const uint64_t* touched,
+    bool want_touched, std::vector<size_t>& pages);
+  // Pages a layer can still take in. Unbounded with the cache rings for
+  // every layer above the last, migrations there demote to make room.
+  size_t roomIn(PageLayer layer);
+
+  // Fold the kernel accessed bits into the page metadata, no-op with
+  // software hotness
+  void sampleAccessBits();
 
   // Write operations
   void accessPage(size_t page_id, OperationType mode);
   void migratePage(size_t page_id, PageLayer new_layer);
-
-  // Promotion to huge pages
+  // Move a batch of pages to one layer with a single backend call,
+  // safe to call from several migration workers
+  void migratePages(const std::vector<size_t>& page_ids, PageLayer new_layer);
+  // Move whole regions, each region's pages in the same backend call. A
+  // region moves only if the target layer has room for all of it.
+  void migrateRegions(const std::vector<size_t>& regions, PageLayer new_layer);
+
+  // Huge page advice for the tiers, called once per scan round. Under
+  // the hot policy, ranges are judged by the pages accessed since the
+  // previous call.
   void promoteToHugePage();
 
 private:
   void _allocateMemory();
-  void _generateRandomContent();
+  // Write the initial content of every tier, in parallel and pinned to
+  // the tier's node
+  void _generateContent();
+  void _fillRegion(char* base, size_t bytes, PageLayer layer, int numa_node,
+    size_t num_threads);
+  static const char* _contentName(ContentType content);
+  static double _elapsedMs(boost::chrono::steady_clock::time_point start);
+
+  // Move page_ids, group_ends are the end indices of groups that take
+  // target room all or nothing. Empty groups every page on its own.
+  void _migrate(const std::vector<size_t>& page_ids, const std::vector<size_t>& group_ends,
+    PageLayer new_layer);
+  void _commitMigration(size_t page_id, PageLayer new_layer, uint64_t now_ms);
+
+  // Region bookkeeping, set up once the pages are placed
+  void _initRegions();
+  size_t _regionOf(size_t page_id) const
+  {
+    size_t region = region_lookup_[page_id / REGION_PAGES];
+    while (region_start_[region + 1] <= page_id)
+    {
+      region++;
+    }
+    return region;
+  }
+  // Count an access to a page against its region
+  void _touchRegion(size_t page_id, uint64_t now_ms);
+  // Mark a page accessed this huge page round, page mode
+  inline void _touchPage(size_t page_id)
+  {
+    if (page_touched_.empty())
+    {
+      return;
+    }
+    std::atomic<uint64_t>& word = page_touched_[page_id / 64];
+    uint64_t bit = 1ULL << (page_id % 64);
+    if (!(word.load(std::memory_order_relaxed) & bit))
+    {
+      word.fetch_or(bit, std::memory_order_relaxed);
+    }
+  }
+  // Move a page between layers in its region's per-layer counts and
+  // refresh the region's majority layer, migration_mutex_ held
+  void _moveRegionPage(size_t page_id, PageLayer from, PageLayer to);
+  // Move ring victims of layer one layer down, victims that cannot move
+  // rejoin the ring
+  void _demotePages(PageLayer layer, const std::vector<size_t>& victims);
+  // Layer a full layer demotes to, false for the last layer
+  bool _lowerLayer(PageLayer layer, PageLayer& lower) const;
+  ClockRing* _ring(PageLayer layer) { return tier_rings_[static_cast<size_t>(layer)].get(); }
+  LayerInfo* _getLayerInfo(PageLayer layer);
+  static size_t _freeSlots(const LayerInfo& info)
+  {
+    return info.isFull() ? 0 : info.capacity - info.count;
+  }
 
   std::vector<ClientConfig> client_configs_;
   ServerMemoryConfig* server_config_;
 
-  boost::unordered_map<size_t, PageTableEntry> table_;
+  // Dense page table: page id indexes both arrays directly. Addresses are
+  // atomic because the emulated backend relocates pages on migration.
+  std::vector<std::atomic<void*>> page_address_;
+  PageMetadataArray metadata_;
 
   void* local_base_ = nullptr;
   void* remote_base_ = nullptr;
@@ -83,10 +176,47 @@ private:
   size_t remote_page_load_ = 0;
   size_t pmem_page_load_ = 0;
 
-  size_t scan_index_ = 0;
+  std::unique_ptr<TierBackend> backend_;
+
+  // Set when hotness comes from kernel accessed bits, requests then leave
+  // recency and frequency alone
+  std::unique_ptr<IdlePageTracker> idle_tracker_;
+  std::vector<void*> sample_addresses_;
+  std::vector<uint8_t> sample_accessed_;
+
+  bool region_mode_ = false;
+  // First page of every region, then the page count
+  std::vector<size_t> region_start_;
+  // Region holding the first page of every REGION_PAGES page ids
+  std::vector<uint32_t> region_lookup_;
+  // Recency, frequency and majority layer of each region
+  PageMetadataArray region_metadata_;
+  // Reapplied when region_metadata_ is rebuilt
+  size_t half_life_ms_ = 0;
+  // Bit per page, set by accesses and taken by the scanner
+  std::vector<std::atomic<uint64_t>> region_touched_;
+  // Pages of each region on each layer, migration_mutex_ held
+  std::vector<std::array<uint16_t, 3>> region_layer_pages_;
+  // Touched bits the scanner took from each region last round
+  std::vector<uint64_t> region_round_touched_;
+
+  // Set under the hot huge page policy
+  std::unique_ptr<HugePageAdvisor> huge_page_advisor_;
+  // Bit per page accessed since the last promoteToHugePage, page mode
+  // under the hot policy. Last access times cannot tell, migration
+  // stamps them too.
+  std::vector<std::atomic<uint64_t>> page_touched_;
+  bool huge_pages_advised_ = false;
+
+  // Guards layer info counts, layer changes, ring membership and migrating_
+  boost::mutex migration_mutex_;
+  // Pages currently being moved, a page is in at most one migration
+  boost::unordered_set<size_t> migrating_;
 
   bool enable_cache_ring_ = false;
-  std::unique_ptr<ClockRing> local_cache_ring_ = nullptr;
+  // GCLOCK ring per layer, indexed by PageLayer. A page's ring handle
+  // belongs to the ring of its current layer.
+  std::unique_ptr<ClockRing> tier_rings_[3];
 };
 
 #endif // PAGETABLE_H
\ No newline at end of file
@@ -2,47 +2,96 @@
 #define SCANNER_HPP
 
 #include "Common.hpp"
+#include "LatencyHistogram.hpp"
 #include "Logger.hpp"
+#include "MigrationEngine.hpp"
+#include "PageClassifier.hpp"
 #include "PageTable.hpp"
 #include "RingBuffer.hpp"
 
 #include <boost/chrono.hpp>
+#include <boost/thread/barrier.hpp>
 #include <boost/thread/thread.hpp>
 #include <chrono>
 #include <iostream>
 
 class Server;
 
-enum class PageStatus {
-  HOT,
-  WARM,
-  COLD
-};
-
 class Scanner {
 private:
   PageTable* page_table_;
   PolicyConfig* policy_config_;
+  ServerMemoryConfig* server_config_;
 
   bool scanner_shutdown_flag_ = false;
   boost::mutex scanner_shutdown_mutex_;
 
   bool _shouldShutdown();
 
-  // Check if a single page is hot
-  bool classifyHotPage(const uint64_t last_access_time, uint32_t access_count) const;
+  // Executes migration decisions asynchronously
+  MigrationEngine* migration_engine_;
+
+  void _queueMigration(size_t page_id, PageLayer source_layer, PageLayer target_layer);
+
+  /**
+   * One scanner thread and the contiguous page range it owns, a region
+   * range in region mode
+   */
+  struct ScanWorker
+  {
+    size_t first_page;
+    size_t end_page;
+    size_t round_pages = 0;
+    ClassifyBlock block;
+    RegionTouchBlock touched;
+    // Region decisions moved whole / split into page moves this round
+    size_t round_whole_regions = 0;
+    size_t round_split_regions = 0;
+    std::vector<size_t> region_pages;
+    boost::chrono::nanoseconds round_busy{ 0 };
+    // Page recency (ms since last access) and decayed access count of the
+    // current round, the next round's thresholds come from them
+    HistogramSnapshot recency_histogram;
+    HistogramSnapshot frequency_histogram;
+  };
+  std::vector<ScanWorker> workers_;
+
+  // Round state, written by worker 0 between barriers
+  boost::chrono::steady_clock::time_point round_start_;
+  bool stop_ = false;
 
-  // Check if a single page is cold
-  bool classifyColdPage(const uint64_t last_access_time, uint32_t access_count) const;
+  // Pages, or regions in region mode
+  size_t _scanUnits() const;
+  void _runWorker(size_t worker_id, size_t num_tiers, boost::barrier& barrier);
+  // Flush, adapt, promote and log a round, then wait out the interval
+  void _finishRound();
+
+  // Classify up to CLASSIFY_BLOCK_SIZE pages at once and queue their
+  // migrations
+  void _scanBlock(ScanWorker& worker, const PageClassifier& classifier, size_t first_page,
+    size_t count, uint64_t now_ms);
+  // Same for regions. A decision moves the region whole when enough of its
+  // pages back it, accessed pages a promotion and idle pages a demotion,
+  // otherwise only the backing pages move.
+  void _scanRegionBlock(ScanWorker& worker, const PageClassifier& classifier,
+    size_t first_region, size_t count, uint64_t now_ms);
+
+  void _recordPage(ScanWorker& worker, uint64_t age_ms, uint32_t access_count);
+
+  // Pick thresholds so the hottest pages fill the local tier and the pages
+  // that fit in no faster tier are cold, then start a new round
+  void _adaptThresholds();
 
 public:
   // Constructor
-  Scanner(PageTable* page_table, PolicyConfig* policy_config);
-
-  // Check page status HOT / WARM / COLD
-  PageStatus classifyPage(uint64_t last_access_time, uint32_t access_count) const;
+  Scanner(PageTable* page_table, PolicyConfig* policy_config,
+    ServerMemoryConfig* server_config, MigrationEngine* migration_engine);
 
-  // Continuously classify pages
+  // Continuously classify pages with policy_config->scanner_threads
+  // threads, each owning a contiguous page range. Threads scan in chunks,
+  // paced so a round spreads over the scan interval, and meet at the end
+  // of every round. In region mode the unit is a region: chunk size and
+  // scan rate count regions.
   void runScanner(size_t num_tiers);
 
   // Stop scanner
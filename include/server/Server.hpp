@@ -1,27 +1,32 @@
 #ifndef SERVER_H
 #define SERVER_H
 
+#include <atomic>
 #include <boost/chrono.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include "Common.hpp"
 #include "Logger.hpp"
 #include "Metrics.hpp"
+#include "MigrationEngine.hpp"
 #include "PageTable.hpp"
 #include "RingBuffer.hpp"
+#include "Timing.hpp"
 #include "Scanner.hpp"
 #include "Utils.hpp"
 
 class Server {
 public:
-  Server(RingBuffer<ClientMessage>& client_buffer,
+  Server(const std::vector<RingBuffer<ClientMessage>*>& client_buffers,
     const std::vector<ClientConfig>& client_configs,
     ServerMemoryConfig* server_config, PolicyConfig* policy_config,
-    bool use_cache_ring, size_t sample_rate, const std::string periodic_metric_filename);
+    bool use_cache_ring, size_t sample_rate, size_t batch_size,
+    size_t manager_threads, const std::string periodic_metric_filename);
   ~Server();
 
   void handleClientMessage(const ClientMessage& msg);
@@ -30,8 +35,18 @@ public:
   void signalShutdown();
 
 private:
+  /**
+   * A manager worker owns a subset of client queues, and therefore the
+   * contiguous page id ranges of those clients
+   */
+  struct ManagerWorker {
+    std::vector<RingBuffer<ClientMessage>*> buffers;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> handled_requests{ 0 };
+    std::atomic<uint64_t> idle_rounds{ 0 };
+  };
+
   // start function
-  void _runManagerThread();
+  void _runManagerThread(size_t worker_id);
   void _runScannerThread();
   void _runPeriodicalMetricsThread();
 
@@ -39,21 +54,23 @@ private:
   bool _shouldShutdown();
 
   // private variable
-  RingBuffer<ClientMessage>& client_buffer_;
+  std::vector<std::unique_ptr<ManagerWorker>> workers_;
   PageTable* page_table_;
   Scanner* scanner_;
+  MigrationEngine* migration_engine_;
   size_t sample_rate_;
+  size_t batch_size_;
 
   ServerMemoryConfig* server_config_;
-  std::vector<bool> client_done_flags_;
+  size_t num_clients_;
+  std::atomic<size_t> clients_done_{ 0 };
 
   std::string periodic_metric_filename_;
 
   // Base page id for each memory layer
   std::vector<size_t> base_page_id_;
 
-  bool manager_shutdown_flag_ = false;
-  boost::mutex manager_shutdown_mutex_;
+  std::atomic<bool> manager_shutdown_flag_{ false };
 };
 
 #endif // SERVER_H
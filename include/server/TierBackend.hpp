@@ -0,0 +1,131 @@
+#ifndef TIER_BACKEND_HPP
+#define TIER_BACKEND_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/thread/mutex.hpp>
+#include <memory>
+#include <vector>
+
+#include "Common.hpp"
+#include "Logger.hpp"
+#include "Utils.hpp"
+
+/**
+ * Physical placement of the memory tiers.
+ *
+ * The page table only sees page addresses and layers. A backend decides
+ * where each tier's memory lives, how an access to it is timed, and how a
+ * page moves between tiers. Migration may change a page's address, callers
+ * must use the address written back by migratePages.
+ */
+class TierBackend
+{
+public:
+  virtual ~TierBackend() = default;
+
+  // Allocate a tier holding num_pages pages, with room for capacity pages.
+  // Returns nullptr on failure.
+  virtual void* allocateTier(PageLayer layer, size_t num_pages, size_t capacity) = 0;
+  virtual void releaseTier(PageLayer layer) = 0;
+
+  // Bytes mapped for a tier, including room for pages migrated in
+  virtual size_t tierBytes(PageLayer layer) const = 0;
+  // NUMA node backing a tier, -1 if the tier is not bound to one
+  virtual int numaNode(PageLayer layer) const = 0;
+
+  // Access one page, returns the access latency in nanoseconds
+  virtual uint64_t accessPage(void* addr, PageLayer layer, OperationType mode) = 0;
+
+  // Move pages to target_layer. pages[i] is updated to the page's new
+  // address and moved[i] reports whether the page reached the target.
+  virtual void migratePages(void** pages, size_t number, PageLayer target_layer,
+    bool* moved) = 0;
+
+  virtual const char* name() const = 0;
+};
+
+/**
+ * Tiers are NUMA nodes: local is node 0, remote node 1, PMEM node 2.
+ * Pages move with move_pages and keep their address.
+ */
+class NumaTierBackend : public TierBackend
+{
+public:
+  explicit NumaTierBackend(size_t num_tiers) : num_tiers_(num_tiers) {}
+  ~NumaTierBackend() override;
+
+  void* allocateTier(PageLayer layer, size_t num_pages, size_t capacity) override;
+  void releaseTier(PageLayer layer) override;
+  size_t tierBytes(PageLayer layer) const override { return size_[static_cast<size_t>(layer)]; }
+  int numaNode(PageLayer layer) const override
+  {
+    // With two tiers DRAM is not bound to a node
+    return (num_tiers_ == 2 && layer == PageLayer::NUMA_LOCAL) ? -1 : layer_to_numa_node(layer);
+  }
+  uint64_t accessPage(void* addr, PageLayer layer, OperationType mode) override
+  {
+    return access_page(addr, mode);
+  }
+  void migratePages(void** pages, size_t number, PageLayer target_layer,
+    bool* moved) override;
+  const char* name() const override { return "numa"; }
+
+private:
+  size_t num_tiers_;
+  void* base_[3] = { nullptr, nullptr, nullptr };
+  size_t size_[3] = { 0, 0, 0 };
+};
+
+/**
+ * Tiers are anonymous regions on whatever node the process runs on.
+ *
+ * Each tier is sized to its capacity and hands out page slots from a free
+ * list. Accesses pay the tier's configured extra latency plus a transfer
+ * cost against the tier's bandwidth, so concurrent accesses to a slow tier
+ * queue behind each other. Migration copies the page into a free slot of
+ * the target tier and returns the new address.
+ */
+class EmulatedTierBackend : public TierBackend
+{
+public:
+  explicit EmulatedTierBackend(const TierBackendConfig& config) : config_(config) {}
+  ~EmulatedTierBackend() override;
+
+  void* allocateTier(PageLayer layer, size_t num_pages, size_t capacity) override;
+  void releaseTier(PageLayer layer) override;
+  size_t tierBytes(PageLayer layer) const override
+  {
+    return tiers_[static_cast<size_t>(layer)].capacity * PAGE_SIZE;
+  }
+  int numaNode(PageLayer layer) const override { return -1; }
+  uint64_t accessPage(void* addr, PageLayer layer, OperationType mode) override;
+  void migratePages(void** pages, size_t number, PageLayer target_layer,
+    bool* moved) override;
+  const char* name() const override { return "emulated"; }
+
+private:
+  struct alignas(CACHE_LINE_SIZE) Tier
+  {
+    char* base = nullptr;
+    size_t capacity = 0;
+    std::vector<size_t> free_slots;
+    // Time (ns) until which the tier's bandwidth is taken
+    std::atomic<uint64_t> busy_until_ns{ 0 };
+  };
+
+  // Wait out the modelled cost of moving bytes through a tier, returns the
+  // injected delay in nanoseconds
+  uint64_t _injectDelay(PageLayer layer, size_t bytes, bool with_latency);
+  Tier* _tierOf(void* addr);
+
+  TierBackendConfig config_;
+  Tier tiers_[3];
+  // Guards the free slot lists
+  boost::mutex slot_mutex_;
+};
+
+std::unique_ptr<TierBackend> createTierBackend(const ServerMemoryConfig& config);
+
+#endif // TIER_BACKEND_HPP
@@ -0,0 +1,144 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#include <atomic>
+#include <boost/thread/thread.hpp>
+#include <cstdint>
+#include <time.h>
+
+#include "Common.hpp"
+
+/**
+ * Millisecond timestamps for page metadata.
+ *
+ * Access timestamps only need millisecond resolution, a full clock read per
+ * request is wasted on them. COARSE reads CLOCK_MONOTONIC_COARSE, which the
+ * vDSO answers from the last timer tick without touching the clocksource.
+ * TICKER reads a value a background thread refreshes every millisecond,
+ * a single relaxed load, but stalls when the thread does not get a CPU.
+ * Every source counts from the CLOCK_MONOTONIC epoch, as steady_clock does,
+ * so their timestamps compare; coarse ones trail by up to a tick.
+ */
+class CoarseClock
+{
+public:
+  // Select the source, starting the ticker thread if it needs one. Call
+  // before other threads take timestamps.
+  static void start(ClockSource source);
+  static void stop();
+
+  static inline uint64_t nowMs()
+  {
+    switch (source_)
+    {
+    case ClockSource::TICKER:
+      return ticker_ms_.load(std::memory_order_relaxed);
+    case ClockSource::COARSE:
+      return _readMs(CLOCK_MONOTONIC_COARSE);
+    default:
+      return _readMs(CLOCK_MONOTONIC);
+    }
+  }
+
+  static ClockSource source() { return source_; }
+  static const char* sourceName(ClockSource source);
+
+private:
+  static inline uint64_t _readMs(clockid_t clock)
+  {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+  }
+
+  static void _runTicker();
+
+  static ClockSource source_;
+  static std::atomic<uint64_t> ticker_ms_;
+  static std::atomic<bool> ticker_stop_;
+  static boost::thread ticker_;
+};
+
+/**
+ * Nanosecond timer for access latency.
+ *
+ * TSC reads the time stamp counter, fenced so the measured access cannot
+ * move across it, and converts ticks with a rate calibrated against
+ * CLOCK_MONOTONIC at start. It needs an invariant TSC, start() falls back to
+ * CLOCK otherwise.
+ */
+class LatencyTimer
+{
+public:
+  static void start(LatencyTimerSource source);
+
+  // Opaque start point for elapsedNs
+  static inline uint64_t begin()
+  {
+    if (source_ == LatencyTimerSource::TSC)
+    {
+      return _readTsc();
+    }
+    return _clockNs();
+  }
+
+  static inline uint64_t elapsedNs(uint64_t start)
+  {
+    if (source_ == LatencyTimerSource::TSC)
+    {
+      uint64_t end = _readTscp();
+      return static_cast<uint64_t>(static_cast<double>(end - start) * ns_per_tick_);
+    }
+    return _clockNs() - start;
+  }
+
+  // Nanoseconds on the CLOCK_MONOTONIC scale
+  static inline uint64_t nowNs()
+  {
+    if (source_ == LatencyTimerSource::TSC)
+    {
+      return base_ns_ + static_cast<uint64_t>(
+        static_cast<double>(_readTsc() - base_tsc_) * ns_per_tick_);
+    }
+    return _clockNs();
+  }
+
+  static LatencyTimerSource source() { return source_; }
+  static const char* sourceName(LatencyTimerSource source);
+  // Calibrated TSC rate, 0 before calibration
+  static double tscGhz() { return ns_per_tick_ > 0 ? 1.0 / ns_per_tick_ : 0.0; }
+
+private:
+  static inline uint64_t _clockNs()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+
+  // Counter after earlier instructions complete. Inline asm rather than
+  // x86intrin.h, whose _rotl macro clashes with Xoshiro.
+  static inline uint64_t _readTsc()
+  {
+    uint32_t low, high;
+    asm volatile("lfence\n\trdtsc" : "=a"(low), "=d"(high) : : "memory");
+    return (static_cast<uint64_t>(high) << 32) | low;
+  }
+  // Counter before later instructions start
+  static inline uint64_t _readTscp()
+  {
+    uint32_t low, high;
+    asm volatile("rdtscp\n\tlfence" : "=a"(low), "=d"(high) : : "rcx", "memory");
+    return (static_cast<uint64_t>(high) << 32) | low;
+  }
+
+  static bool _invariantTsc();
+  static void _calibrate();
+
+  static LatencyTimerSource source_;
+  static double ns_per_tick_;
+  static uint64_t base_tsc_;
+  static uint64_t base_ns_;
+};
+
+#endif // TIMING_HPP
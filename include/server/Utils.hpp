@@ -5,6 +5,8 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,6 +17,7 @@
 #include <unistd.h>
 
 #include "Common.hpp"
+#include "Timing.hpp"
 
 //======================================
 // Constants and Configurations
@@ -24,6 +27,8 @@
 #define PAGE_SIZE 4096 // Default system page size
 #endif
 
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024) // Transparent huge page size
+
 //======================================
 // Utility Functions
 //======================================
@@ -49,14 +54,40 @@ inline void flush_cache(void* addr) { _mm_clflush(addr); }
 //======================================
 
 /**
- * Allocate memory pages on DRAM
+ * Map anonymous memory starting on a huge page boundary, so each 2 MB of
+ * it can be backed by one transparent huge page. Over-maps by a huge page
+ * and unmaps the slack on both sides.
+ * @param bytes Bytes to map, a multiple of the base page size
+ * @return Pointer to mapped memory, MAP_FAILED on failure
+ */
+inline void* map_huge_aligned(size_t bytes) {
+  size_t padded = bytes + HUGE_PAGE_SIZE;
+  void* mem = mmap(NULL, padded, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    return MAP_FAILED;
+  }
+  uintptr_t start = reinterpret_cast<uintptr_t>(mem);
+  uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+  size_t head = aligned - start;
+  size_t tail = padded - head - bytes;
+  if (head) {
+    munmap(mem, head);
+  }
+  if (tail) {
+    munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+  }
+  return reinterpret_cast<void*>(aligned);
+}
+
+/**
+ * Allocate memory pages on DRAM. Pages are faulted in by the first write.
  * @param size Size of each page
  * @param number Number of pages to allocate
- * @return Pointer to allocated memory
+ * @return Pointer to allocated memory, aligned to HUGE_PAGE_SIZE
  */
 inline void* allocate_pages(size_t size, size_t number) {
-  void* mem = mmap(NULL, size * number, PROT_READ | PROT_WRITE,
-    MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  void* mem = map_huge_aligned(size * number);
   if (mem == MAP_FAILED) {
     perror("mmap failed");
     exit(EXIT_FAILURE);
@@ -65,17 +96,17 @@ inline void* allocate_pages(size_t size, size_t number) {
 }
 
 /**
- * Allocate and bind memory pages to specific NUMA node
+ * Allocate and bind memory pages to specific NUMA node. Pages are faulted
+ * in on the node by the first write.
  * @param size Size of each page
  * @param number Number of pages to allocate
  * @param numa_node Target NUMA node
- * @return Pointer to allocated memory
+ * @return Pointer to allocated memory, aligned to HUGE_PAGE_SIZE
  */
 inline void* allocate_and_bind_to_numa(size_t size, size_t number,
   int numa_node) {
   // Allocate memory
-  void* addr = mmap(NULL, size * number, PROT_READ | PROT_WRITE,
-    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  void* addr = map_huge_aligned(size * number);
   if (addr == MAP_FAILED) {
     perror("mmap failed");
     return NULL;
@@ -83,98 +114,100 @@ inline void* allocate_and_bind_to_numa(size_t size, size_t number,
 
   // Bind to NUMA node
   unsigned long nodemask = (1UL << numa_node);
-  if (syscall(SYS_mbind, addr, size, MPOL_BIND, &nodemask, sizeof(nodemask) * 8,
+  if (syscall(SYS_mbind, addr, size * number, MPOL_BIND, &nodemask, sizeof(nodemask) * 8,
     MPOL_MF_MOVE | MPOL_MF_STRICT) != 0) {
     perror("mbind syscall failed");
     munmap(addr, size * number);
     return NULL;
   }
-
-  // Initialize memory
-  memset(addr, 0, size * number);
   return addr;
 }
 
-//======================================
-// Page Migration
-//======================================
-
 /**
- * Move a single page to specified NUMA node
- * @param addr Page address
- * @param target_node Target NUMA node
+ * Pin the calling thread to the CPUs of a NUMA node
+ * @param numa_node Target NUMA node
+ * @return true if pinned, false if the node has no CPUs or is unknown
  */
-inline void move_page_to_node(void* addr, int target_node) {
-  void* pages[1] = { addr };
-  int nodes[1] = { target_node };
-  int status[1];
-
-  if (syscall(SYS_move_pages, 0, 1, pages, nodes, status, MPOL_MF_MOVE) != 0) {
-    perror("move_pages failed");
-    exit(EXIT_FAILURE);
+inline bool pin_thread_to_numa_node(int numa_node) {
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", numa_node);
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    return false;
+  }
+  char list[1024];
+  if (!fgets(list, sizeof(list), file)) {
+    fclose(file);
+    return false;
+  }
+  fclose(file);
+
+  // cpulist format: "0-3,8,10-11"
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  char* cursor = list;
+  while (*cursor >= '0' && *cursor <= '9') {
+    long first = strtol(cursor, &cursor, 10);
+    long last = first;
+    if (*cursor == '-') {
+      last = strtol(cursor + 1, &cursor, 10);
+    }
+    for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+      CPU_SET(cpu, &cpus);
+    }
+    if (*cursor == ',') {
+      cursor++;
+    }
+  }
+  if (CPU_COUNT(&cpus) == 0) {
+    return false;
   }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
 }
 
+//======================================
+// Page Migration
+//======================================
+
 /**
- * Move multiple pages to specified NUMA node
- * @param addr Starting address of pages
- * @param size Size of each page
+ * Move an arbitrary list of pages to specified NUMA node in one syscall
+ * @param pages Page addresses
  * @param number Number of pages to move
  * @param target_node Target NUMA node
+ * @param status Per-page result: node the page is on, or negative errno
+ * @return Syscall result, 0 if all pages moved, negative on failure
  */
-inline void move_pages_to_node(void* addr, size_t size, size_t number,
-  int target_node) {
-  void** pages = (void**)malloc(number * sizeof(void*));
+inline long move_page_list_to_node(void** pages, size_t number,
+  int target_node, int* status) {
   int* nodes = (int*)malloc(number * sizeof(int));
-  int* status = (int*)malloc(number * sizeof(int));
-  if (!pages || !nodes || !status) {
+  if (!nodes) {
     perror("Memory allocation failed");
-    free(pages);
-    free(nodes);
-    free(status);
-    exit(EXIT_FAILURE);
+    return -1;
   }
-
-  // Setup page and node arrays
   for (size_t i = 0; i < number; i++) {
-    pages[i] = (char*)addr + i * size;
     nodes[i] = target_node;
+    status[i] = -EBUSY;
   }
 
-  // Perform migration
-  if (syscall(SYS_move_pages, 0, number, pages, nodes, status, MPOL_MF_MOVE) !=
-    0) {
+  long ret = syscall(SYS_move_pages, 0, number, pages, nodes, status,
+    MPOL_MF_MOVE);
+  if (ret < 0) {
     perror("move_pages failed");
-    free(pages);
-    free(nodes);
-    free(status);
-    exit(EXIT_FAILURE);
   }
 
-  // Check migration status
-  for (size_t i = 0; i < number; i++) {
-    if (status[i] < 0) {
-      fprintf(stderr, "Failed to move page %zu: error code %d\n", i, status[i]);
-    }
-  }
-
-  free(pages);
   free(nodes);
-  free(status);
+  return ret;
 }
 
 /**
- * Migrate a page between memory tiers
- * @param addr Page address
- * @param current_tier Current memory tier
- * @param target_tier Target memory tier
+ * Map a memory tier to its NUMA node
+ * @param tier Memory tier
+ * @return NUMA node id
  */
-inline void migrate_page(void* addr, PageLayer current_tier,
-  PageLayer target_tier) {
-  int target_node = (target_tier == PageLayer::NUMA_LOCAL) ? 0
-    : (target_tier == PageLayer::NUMA_REMOTE) ? 1
+inline int layer_to_numa_node(PageLayer tier) {
+  return (tier == PageLayer::NUMA_LOCAL) ? 0
+    : (tier == PageLayer::NUMA_REMOTE) ? 1
     : 2;
-  return move_page_to_node(addr, target_node);
 }
 
 //======================================
@@ -185,7 +218,7 @@ inline void migrate_page(void* addr, PageLayer current_tier,
  * Access a specific memory page
  * @param addr Page address
  * @param mode Memory access mode (read/write)
- * @return Access time in nanoseconds
+ * @return Access time in nanoseconds, measured with LatencyTimer
  */
 inline uint64_t access_page(void* addr, OperationType mode) {
   volatile uint64_t* page = (volatile uint64_t*)addr;
@@ -194,7 +227,7 @@ inline uint64_t access_page(void* addr, OperationType mode) {
   flush_cache(addr);
   _mm_mfence(); // Add memory fence to ensure flush completes
 
-  uint64_t start_time = get_time_ns();
+  uint64_t start_time = LatencyTimer::begin();
 
   uint64_t value_1;
   uint64_t value_2 = 44;
@@ -216,7 +249,7 @@ inline uint64_t access_page(void* addr, OperationType mode) {
     break;
   }
 
-  return (get_time_ns() - start_time);
+  return LatencyTimer::elapsedNs(start_time);
 }
 
 #endif // UTILS_HPP
@@ -15,15 +15,28 @@ int main(int argc, char* argv[]) {
     return config.isHelpRequested() ? 0 : 1;
   }
 
-  // Set up client-server request buffer, get client configurations
-  RingBuffer<ClientMessage> clientRequestBuffer(config.getBufferSize());
+  // Set up client-server request buffers, get client configurations.
+  // MPSC mode gives each manager thread one shared queue, SPSC gives each
+  // client its own. Client i pushes to buffer i % numBuffers.
   const auto& clientConfigs = config.getClientConfigs();
+  size_t numBuffers = config.getQueueMode() == RingBufferMode::SPSC
+    ? clientConfigs.size()
+    : config.getManagerThreads();
+  std::vector<std::unique_ptr<RingBuffer<ClientMessage>>> clientRequestBuffers;
+  std::vector<RingBuffer<ClientMessage>*> clientRequestBufferPtrs;
+  for (size_t i = 0; i < numBuffers; i++) {
+    clientRequestBuffers.push_back(std::make_unique<RingBuffer<ClientMessage>>(
+      config.getBufferSize(), config.getQueueMode()));
+    clientRequestBufferPtrs.push_back(clientRequestBuffers.back().get());
+  }
 
   // Create and initialize server
   ServerMemoryConfig serverConfig = config.getServerMemoryConfig();
   PolicyConfig policyConfig = config.getPolicyConfig();
-  Server server(clientRequestBuffer, clientConfigs, &serverConfig,
-    &policyConfig, config.getUseCacheRing(), config.getSampleRate(), config.getPeriodicMetricFile());
+  Server server(clientRequestBufferPtrs, clientConfigs, &serverConfig,
+    &policyConfig, config.getUseCacheRing(), config.getSampleRate(),
+    config.getBatchSize(), config.getManagerThreads(),
+    config.getPeriodicMetricFile());
 
   // NOTICE: wait for hot page threshold to expire
   boost::this_thread::sleep_for(boost::chrono::seconds(
@@ -40,8 +53,9 @@ int main(int argc, char* argv[]) {
     }
 
     auto client = std::make_shared<Client>(
-      i, clientRequestBuffer, config.getRunningTime(), clientPageSize,
-      clientConfigs[i].pattern, config.getRwRatio());
+      i, *clientRequestBufferPtrs[i % numBuffers], config.getRunningTime(), clientPageSize,
+      clientConfigs[i].pattern, clientConfigs[i].zipf_s, config.getRwRatio(),
+      config.getBatchSize(), clientConfigs[i].load, clientConfigs[i].trace);
 
     clients.push_back(client);
     clientThreads.emplace_back([client]() { client->run(); });
@@ -66,5 +80,6 @@ int main(int argc, char* argv[]) {
   }
 
   metrics.outputLatencyCDFToFile(config.getLatencyOutputFile());
+  metrics.outputEndToEndCDFToFile(config.getEndToEndLatencyFile());
   return 0;
 }
\ No newline at end of file
@@ -3,13 +3,45 @@
 
 #include <boost/chrono.hpp>
 #include <boost/thread/thread.hpp>
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 Client::Client(size_t client_id, RingBuffer<ClientMessage>& buffer,
   size_t running_time, size_t memory_space_size,
-  AccessPattern pattern, double rw_ratio)
+  AccessPattern pattern, double zipf_s, double rw_ratio, size_t batch_size,
+  const LoadConfig& load, const TraceConfig& trace)
   : buffer_(buffer), client_id_(client_id), running_time_(running_time),
-  generator_(pattern, memory_space_size), rw_ratio_(rw_ratio) {
+  generator_(pattern, memory_space_size, zipf_s), rw_ratio_(rw_ratio),
+  batch_size_(std::max<size_t>(batch_size, 1)), memory_space_size_(memory_space_size),
+  load_(load), arrival_rng_(std::random_device{}()),
+  arrival_gap_(load.target_rate > 0 ? load.target_rate / 1e9 : 1.0),
+  replay_timing_(trace.replay_timing) {
+  if (!trace.record_path.empty()) {
+    recorder_ = std::make_unique<TraceWriter>(trace.record_path);
+  }
+  if (!trace.replay_path.empty()) {
+    replayer_ = std::make_unique<TraceReader>(trace.replay_path);
+    if (replayer_->isOpen()) {
+      LOG_INFO("Client " << client_id_ << " replaying " << replayer_->numRecords()
+        << " records from " << trace.replay_path);
+    }
+    if (replay_timing_ && !replayer_->hasTiming()) {
+      LOG_WARN("Trace " << trace.replay_path << " has no timing, replaying at full speed");
+      replay_timing_ = false;
+    }
+  }
+}
+
+void Client::_pushAll(const ClientMessage* msgs, size_t count) {
+  size_t sent = 0;
+  while (sent < count) {
+    size_t pushed = buffer_.pushBatch(msgs + sent, count - sent);
+    if (pushed == 0) {
+      boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
+    }
+    sent += pushed;
+  }
 }
 
 void Client::run() {
@@ -17,6 +49,12 @@ void Client::run() {
   boost::chrono::steady_clock::time_point start_time =
     boost::chrono::steady_clock::now();
   boost::chrono::seconds total_duration(running_time_);
+  uint64_t start_ns = boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+    start_time.time_since_epoch()).count();
+  next_send_ns_ = static_cast<double>(start_ns);
+
+  std::vector<ClientMessage> batch;
+  batch.reserve(batch_size_);
 
   while (true) {
     boost::chrono::steady_clock::time_point current_time =
@@ -28,20 +66,119 @@ void Client::run() {
       break;
     }
 
-    // TODO: for now we do not generate offset
-    ClientMessage msg(client_id_, generator_.generatePid(), 0,
-      generator_.generateType(rw_ratio_));
-    while (!buffer_.push(msg)) {
-      boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
+    batch.clear();
+    if (replayer_) {
+      if (!_replayBatch(batch, start_time)) {
+        LOG_INFO("Client " << client_id_ << " reached the end of its trace");
+        break;
+      }
+    }
+    else if (load_.target_rate > 0) {
+      _scheduleBatch(batch, start_ns);
+    }
+    else {
+      _generateBatch(batch, boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+        current_time - start_time).count());
     }
+    if (batch.empty()) {
+      continue;
+    }
+    _pushAll(batch.data(), batch.size());
+
+    LOG_DEBUG("client " << client_id_ << " sent batch of " << batch.size()
+      << ", first: " << batch.front().toString());
+  }
 
-    LOG_DEBUG("client " << client_id_ << " sent: " << msg.toString());
+  if (recorder_) {
+    recorder_->close();
   }
 
   // Send last message to notify server
   ClientMessage end_msg(client_id_, 0, 0, OperationType::END);
-  while (!buffer_.push(end_msg)) {
-    boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
-  }
+  _pushAll(&end_msg, 1);
   LOG_DEBUG("client " << client_id_ << " sent: END");
 }
+
+void Client::_generateBatch(std::vector<ClientMessage>& batch, uint64_t now_ns) {
+  // TODO: for now we do not generate offset
+  for (size_t i = 0; i < batch_size_; i++) {
+    batch.emplace_back(client_id_, generator_.generatePid(), 0,
+      generator_.generateType(rw_ratio_));
+    if (recorder_) {
+      recorder_->append(batch.back().pid, batch.back().op_type, now_ns);
+    }
+  }
+}
+
+bool Client::_replayBatch(std::vector<ClientMessage>& batch,
+  boost::chrono::steady_clock::time_point start_time) {
+  while (batch.size() < batch_size_) {
+    TraceRecord record;
+    if (has_pending_) {
+      record = pending_;
+      has_pending_ = false;
+    }
+    else if (!replayer_->next(record)) {
+      return !batch.empty();
+    }
+
+    if (replay_timing_) {
+      auto due = start_time + boost::chrono::nanoseconds(record.timestamp_ns);
+      if (boost::chrono::steady_clock::now() < due) {
+        // Send what is due now, wait for this record on the next call
+        if (!batch.empty()) {
+          pending_ = record;
+          has_pending_ = true;
+          return true;
+        }
+        boost::this_thread::sleep_until(due);
+      }
+    }
+
+    // Traces from a larger client wrap into this client's pages
+    size_t pid = record.pid < memory_space_size_ ? record.pid : record.pid % memory_space_size_;
+    uint64_t scheduled_ns = replay_timing_
+      ? boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+        start_time.time_since_epoch()).count() + record.timestamp_ns
+      : 0;
+    batch.emplace_back(client_id_, pid, 0, record.op_type, scheduled_ns);
+  }
+  return true;
+}
+
+void Client::_scheduleBatch(std::vector<ClientMessage>& batch, uint64_t start_ns) {
+  uint64_t now_ns = _nowNs();
+  if (next_send_ns_ > now_ns) {
+    _waitUntil(static_cast<uint64_t>(next_send_ns_));
+    now_ns = _nowNs();
+  }
+
+  while (batch.size() < batch_size_ && next_send_ns_ <= now_ns) {
+    uint64_t scheduled_ns = static_cast<uint64_t>(next_send_ns_);
+    batch.emplace_back(client_id_, generator_.generatePid(), 0,
+      generator_.generateType(rw_ratio_), scheduled_ns);
+    if (recorder_) {
+      recorder_->append(batch.back().pid, batch.back().op_type, scheduled_ns - start_ns);
+    }
+    next_send_ns_ += load_.arrival == ArrivalProcess::POISSON
+      ? arrival_gap_(arrival_rng_)
+      : 1e9 / load_.target_rate;
+  }
+}
+
+uint64_t Client::_nowNs() {
+  return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+    boost::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Client::_waitUntil(uint64_t deadline_ns) {
+  // Sleep while the deadline is far away, spin the last stretch since a
+  // sleep can overshoot by tens of microseconds
+  const uint64_t spin_ns = 100000;
+  uint64_t now_ns = _nowNs();
+  if (deadline_ns > now_ns + spin_ns) {
+    boost::this_thread::sleep_for(boost::chrono::nanoseconds(deadline_ns - now_ns - spin_ns));
+  }
+  while (_nowNs() < deadline_ns) {
+  }
+}
@@ -1,59 +1,59 @@
 #include "Generator.hpp"
 
+#include <algorithm>
+
+ScatterPermutation::ScatterPermutation(size_t n, uint64_t seed) : n_(std::max<size_t>(n, 1)) {
+  unsigned bits = 1;
+  while (bits < 64 && (1ULL << bits) < n_) {
+    bits++;
+  }
+  mask_ = (bits == 64) ? ~0ULL : (1ULL << bits) - 1;
+  shift_ = bits / 2 + 1;
+  for (uint64_t& key : key_) {
+    key = splitmix64(seed);
+  }
+  key_[1] |= 1;
+  key_[3] |= 1;
+}
+
+ZipfianSampler::ZipfianSampler(size_t n, double s)
+  : n_(static_cast<double>(std::max<size_t>(n, 1))), s_(s) {
+  h_integral_x1_ = _hIntegral(1.5) - 1.0;
+  h_integral_n_ = _hIntegral(n_ + 0.5);
+  threshold_ = 2.0 - _hIntegralInverse(_hIntegral(2.5) - _h(2.0));
+}
+
 MemoryAccessGenerator::MemoryAccessGenerator(AccessPattern pattern,
   size_t memory_space_size, double zipf_s)
-  : pattern_(pattern), memory_space_size_(memory_space_size) {
-  std::random_device rd;
-  rng_ = std::mt19937(rd());
-
-  // HOT distribution
+  : pattern_(pattern), rng_(std::random_device{}()),
+  memory_space_size_(memory_space_size),
+  scatter_(memory_space_size, rng_()) {
   if (pattern == AccessPattern::UNIFORM) {
     uniform_dist_ =
       std::uniform_int_distribution<size_t>(0, memory_space_size_ - 1);
   }
   else if (pattern == AccessPattern::HOT) {
-    std::vector<size_t> all_pages(memory_space_size_);
-    for (size_t i = 0; i < memory_space_size_; i++) {
-      all_pages[i] = i;
-    }
-
-    std::shuffle(all_pages.begin(), all_pages.end(), rng_);
+    // The first 20% of the permuted page space is hot
     size_t hot_count = std::ceil(memory_space_size_ * 0.2);
-
-    for (size_t i = 0; i < hot_count; i++) {
-      hot_pages_[i] = all_pages[i];
-    }
-
     hot_dist_ = std::uniform_int_distribution<size_t>(0, hot_count - 1);
   }
   else if (pattern == AccessPattern::ZIPFIAN) {
-    zipf_prob_.resize(memory_space_size_);
-
-    for (size_t i = 1; i <= memory_space_size_; i++) {
-      zipf_prob_[i - 1] = 1.0 / std::pow(i, zipf_s);
-    }
-
-    std::shuffle(zipf_prob_.begin(), zipf_prob_.end(), rng_);
-
-    zipf_dist_ = std::discrete_distribution<size_t>(zipf_prob_.begin(),
-      zipf_prob_.end());
+    zipf_dist_ = ZipfianSampler(memory_space_size_, zipf_s);
   }
 }
 
 size_t MemoryAccessGenerator::generatePid() {
-  std::uniform_real_distribution<double> uniform(0, 1.0);
-
   switch (pattern_) {
   case AccessPattern::UNIFORM: {
     return uniform_dist_(rng_);
   }
 
   case AccessPattern::HOT: {
-    return hot_pages_[hot_dist_(rng_)];
+    return scatter_(hot_dist_(rng_));
   }
 
   case AccessPattern::ZIPFIAN: {
-    return zipf_dist_(rng_);
+    return scatter_(zipf_dist_(rng_));
   }
   }
   return 0;
@@ -0,0 +1,204 @@
+#include "Trace.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Largest encoding of one record: two 10-byte varints
+constexpr size_t MAX_RECORD_BYTES = 20;
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint64_t zigzagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+} // namespace
+
+TraceWriter::TraceWriter(const std::string& path)
+  : file_(path, std::ios::binary | std::ios::trunc), path_(path) {
+  if (!file_.is_open()) {
+    LOG_ERROR("Failed to open trace file for writing: " << path);
+    return;
+  }
+  // Header is rewritten with the final counts on close
+  TraceFileHeader header{};
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  payload_.reserve(TRACE_CHUNK_BYTES);
+}
+
+TraceWriter::~TraceWriter() {
+  close();
+}
+
+void TraceWriter::append(size_t pid, OperationType op_type, uint64_t timestamp_ns) {
+  if (chunk_.num_records == 0) {
+    chunk_.base_timestamp_ns = timestamp_ns;
+    last_pid_ = 0;
+    last_timestamp_ns_ = timestamp_ns;
+  }
+
+  int64_t pid_delta = static_cast<int64_t>(pid) - static_cast<int64_t>(last_pid_);
+  putVarint(payload_, (zigzagEncode(pid_delta) << 1) | (op_type == OperationType::WRITE));
+  putVarint(payload_, timestamp_ns - last_timestamp_ns_);
+  last_pid_ = pid;
+  last_timestamp_ns_ = timestamp_ns;
+  chunk_.num_records++;
+  num_records_++;
+
+  if (payload_.size() + MAX_RECORD_BYTES > TRACE_CHUNK_BYTES) {
+    _flushChunk();
+  }
+}
+
+void TraceWriter::_flushChunk() {
+  if (chunk_.num_records == 0) {
+    return;
+  }
+  chunk_.payload_bytes = static_cast<uint32_t>(payload_.size());
+  file_.write(reinterpret_cast<const char*>(&chunk_), sizeof(chunk_));
+  file_.write(reinterpret_cast<const char*>(payload_.data()), payload_.size());
+  num_chunks_++;
+  payload_.clear();
+  chunk_ = TraceChunkHeader{};
+}
+
+void TraceWriter::close() {
+  if (!file_.is_open()) {
+    return;
+  }
+  _flushChunk();
+
+  TraceFileHeader header{};
+  memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_VERSION;
+  header.flags = TRACE_FLAG_TIMING;
+  header.num_records = num_records_;
+  header.num_chunks = num_chunks_;
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file_.close();
+  LOG_INFO("Trace " << path_ << " written: " << num_records_ << " records in "
+    << num_chunks_ << " chunks");
+}
+
+TraceReader::TraceReader(const std::string& path) : path_(path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    LOG_ERROR("Failed to open trace file: " << path << ": " << strerror(errno));
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TraceFileHeader)) {
+    LOG_ERROR("Trace file too small: " << path);
+    ::close(fd);
+    return;
+  }
+
+  void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    LOG_ERROR("Failed to map trace file: " << path << ": " << strerror(errno));
+    return;
+  }
+  madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+
+  TraceFileHeader header;
+  memcpy(&header, mapping, sizeof(header));
+  if (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+    header.version != TRACE_VERSION) {
+    LOG_ERROR("Not a version " << TRACE_VERSION << " trace file: " << path);
+    munmap(mapping, st.st_size);
+    return;
+  }
+
+  data_ = static_cast<const uint8_t*>(mapping);
+  size_ = st.st_size;
+  flags_ = header.flags;
+  num_records_ = header.num_records;
+  offset_ = sizeof(header);
+}
+
+TraceReader::~TraceReader() {
+  if (data_) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+}
+
+bool TraceReader::_openChunk() {
+  if (offset_ + sizeof(TraceChunkHeader) > size_) {
+    return false;
+  }
+  TraceChunkHeader chunk;
+  memcpy(&chunk, data_ + offset_, sizeof(chunk));
+  offset_ += sizeof(chunk);
+  if (offset_ + chunk.payload_bytes > size_) {
+    LOG_ERROR("Truncated chunk in trace file: " << path_);
+    return false;
+  }
+  chunk_end_ = offset_ + chunk.payload_bytes;
+  chunk_left_ = chunk.num_records;
+  last_pid_ = 0;
+  last_timestamp_ns_ = chunk.base_timestamp_ns;
+  return true;
+}
+
+bool TraceReader::_readVarint(uint64_t& value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64 && offset_ < chunk_end_; shift += 7) {
+    uint8_t byte = data_[offset_++];
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  LOG_ERROR("Corrupt record in trace file: " << path_);
+  return false;
+}
+
+bool TraceReader::next(TraceRecord& record) {
+  if (!data_) {
+    return false;
+  }
+  while (chunk_left_ == 0) {
+    offset_ = std::max(offset_, chunk_end_);
+    if (!_openChunk()) {
+      return false;
+    }
+  }
+
+  uint64_t encoded;
+  if (!_readVarint(encoded)) {
+    return false;
+  }
+  last_pid_ = static_cast<size_t>(static_cast<int64_t>(last_pid_) + zigzagDecode(encoded >> 1));
+  record.pid = last_pid_;
+  record.op_type = (encoded & 1) ? OperationType::WRITE : OperationType::READ;
+
+  if (hasTiming()) {
+    uint64_t delta;
+    if (!_readVarint(delta)) {
+      return false;
+    }
+    last_timestamp_ns_ += delta;
+  }
+  record.timestamp_ns = last_timestamp_ns_;
+  chunk_left_--;
+  return true;
+}
@@ -1,4 +1,5 @@
 #include "ConfigParser.hpp"
+#include "ClockRing.hpp"
 #include "Logger.hpp"
 
 std::vector<std::string> ConfigParser::_split(const std::string& s,
@@ -21,17 +22,39 @@ ConfigParser::ConfigParser()
 
   options_.add_options()
     ("b,buffer-size", "Size of ring buffer", cxxopts::value<size_t>()->default_value("10"))
+    ("batch-size", "Number of requests pushed/popped per queue operation", cxxopts::value<size_t>()->default_value("8"))
+    ("manager-threads", "Number of manager threads, clients are partitioned across them", cxxopts::value<size_t>()->default_value("1"))
+    ("queue-mode", "Client request queue mode (mpsc: one shared queue | spsc: one queue per client)", cxxopts::value<std::string>()->default_value("mpsc"))
     ("c,client-tier-sizes", "Memory space size per tier per client (client1_local,client1_remote,client1_pmem ...)", cxxopts::value<std::vector<std::string>>())
     ("running-time", "Running time in seconds per client", cxxopts::value<size_t>())
     ("o,output", "Output file for access latency CDF data", cxxopts::value<std::string>()->default_value("result/latency.csv"))
     ("periodic-output", "Output file for periodical metrics", cxxopts::value<std::string>()->default_value("result/periodic_metrics.csv"))
     ("p,patterns", "Memory access patterns for each client (uniform/hot/zipfian)", cxxopts::value<std::vector<std::string>>())
     ("zipfs", "Zipfian skew factor (e.g., 1.0 = standard Zipf)", cxxopts::value<double>()->default_value("1.0"))
-    ("cache-ring", "Enable NUMA-local cache ring buffer", cxxopts::value<bool>()->default_value("false"))
+    ("target-rate", "Open-loop request rate per client (requests/s), 0 runs closed-loop", cxxopts::value<double>()->default_value("0"))
+    ("arrival", "Open-loop inter-arrival process (poisson|constant)", cxxopts::value<std::string>()->default_value("poisson"))
+    ("e2e-output", "Output file for end-to-end latency CDF data (open-loop runs)", cxxopts::value<std::string>()->default_value("result/e2e_latency.csv"))
+    ("record-trace", "Record each client's access stream to <path>.<client id>", cxxopts::value<std::string>()->default_value(""))
+    ("replay-trace", "Replay each client's access stream from <path>.<client id> instead of generating it", cxxopts::value<std::string>()->default_value(""))
+    ("replay-timing", "Replay traces at their recorded timing instead of full speed", cxxopts::value<bool>()->default_value("false"))
+    ("cache-ring", "Enable per-tier GCLOCK rings, full tiers demote their victims one tier down", cxxopts::value<bool>()->default_value("false"))
+    ("migration-unit", "Unit of hotness tracking and migration (page: 4 KB | region: 2 MB, mixed regions move by page)", cxxopts::value<std::string>()->default_value("page"))
+    ("region-density", "Percent of a region's pages that must be accessed (promotion) or idle (demotion) to move it whole", cxxopts::value<size_t>()->default_value("50"))
+    ("huge-pages", "Transparent huge page advice (none | all: every tier | hot: hot dense 2 MB ranges, cold or sparse ones kept in 4 KB pages)", cxxopts::value<std::string>()->default_value("hot"))
+    ("huge-page-density", "Percent of a 2 MB range's pages accessed in a scan round to back it with a huge page", cxxopts::value<size_t>()->default_value("50"))
+    ("clock-max-count", "Access count ceiling of the cache rings (1 is plain CLOCK)", cxxopts::value<size_t>()->default_value("3"))
     ("r,ratio", "Memory access read/write ratio", cxxopts::value<double>()->default_value("1.0"))
     ("s,mem-sizes", "Memory size in pages for each tier", cxxopts::value<std::vector<size_t>>())
     ("sample-rate", "Periodical sampling rate", cxxopts::value<size_t>()->default_value("10"))
     ("t,num-tiers", "Number of memory tiers", cxxopts::value<size_t>()->default_value("3"))
+    ("tier-backend", "Tier backend (numa: real NUMA nodes | emulated: local memory with injected tier costs)", cxxopts::value<std::string>()->default_value("numa"))
+    ("emulated-latency", "Extra access latency (ns) per tier for the emulated backend", cxxopts::value<std::vector<size_t>>()->default_value("0,80,250"))
+    ("content", "Initial page content (zero|random|pattern)", cxxopts::value<std::string>()->default_value("random"))
+    ("init-threads", "Threads filling page content at startup, 0 uses all CPUs", cxxopts::value<size_t>()->default_value("0"))
+    ("hotness-source", "Page hotness source (software: request counters | idle-bitmap: kernel accessed bits)", cxxopts::value<std::string>()->default_value("software"))
+    ("clock-source", "Page access timestamp clock (steady | coarse: CLOCK_MONOTONIC_COARSE | ticker: thread-updated)", cxxopts::value<std::string>()->default_value("coarse"))
+    ("latency-timer", "Access latency timer (clock: clock_gettime | tsc: calibrated rdtsc)", cxxopts::value<std::string>()->default_value("tsc"))
+    ("emulated-bandwidth", "Bandwidth (MB/s) per tier for the emulated backend, 0 is unlimited", cxxopts::value<std::vector<size_t>>()->default_value("0,0,0"))
     ("policy-type", "Policy type (lru|frequency|hybrid)", cxxopts::value<std::string>()->default_value("lru"))
     ("hot-threshold", "Hot threshold time (ms) for lru/hybrid", cxxopts::value<size_t>()->default_value("100"))
     ("cold-threshold", "Cold threshold time (ms) for lru/hybrid", cxxopts::value<size_t>()->default_value("1000"))
@@ -40,19 +63,57 @@ ConfigParser::ConfigParser()
     ("recency-weight", "Recency weight for hybrid", cxxopts::value<double>()->default_value("0.5"))
     ("frequency-weight", "Frequency weight for hybrid", cxxopts::value<double>()->default_value("0.5"))
     ("scan-interval", "Page table scan interval (in seconds)", cxxopts::value<size_t>()->default_value("30"))
+    ("scanner-threads", "Scanner threads, each classifies a contiguous page range", cxxopts::value<size_t>()->default_value("1"))
+    ("scan-chunk-size", "Pages classified per scanner chunk", cxxopts::value<size_t>()->default_value("1024"))
+    ("scan-rate", "Pages scanned per second, 0 spreads a round evenly over the scan interval", cxxopts::value<size_t>()->default_value("0"))
+    ("scan-cpu-budget", "Percent of one core the scanner may use (1-100)", cxxopts::value<double>()->default_value("100"))
+    ("adaptive-thresholds", "Derive hot/cold thresholds from each scan round so hot pages fill the local tier", cxxopts::value<bool>()->default_value("false"))
+    ("half-life", "Half-life (ms) of page access counts, 0 keeps lifetime counts", cxxopts::value<size_t>()->default_value("0"))
+    ("migration-batch-size", "Max pages moved per move_pages call", cxxopts::value<size_t>()->default_value("64"))
+    ("migration-threads", "Number of migration worker threads", cxxopts::value<size_t>()->default_value("1"))
+    ("migration-queue-size", "Max queued migration jobs before the scanner blocks", cxxopts::value<size_t>()->default_value("4096"))
+    ("migration-flush-interval", "Max time (ms) a migration decision waits in a batch", cxxopts::value<size_t>()->default_value("100"))
     ("h,help", "Print usage information");
 }
 
 bool ConfigParser::_parseBasicConfig(const cxxopts::ParseResult& result)
 {
   buffer_size_ = result["buffer-size"].as<size_t>();
+  batch_size_ = result["batch-size"].as<size_t>();
+  if (batch_size_ == 0)
+  {
+    LOG_ERROR("Batch size must be at least 1");
+    return false;
+  }
+  manager_threads_ = result["manager-threads"].as<size_t>();
+  if (manager_threads_ == 0)
+  {
+    LOG_ERROR("Manager threads must be at least 1");
+    return false;
+  }
   running_time_ = result["running-time"].as<size_t>();
   cdf_output_file_ = result["output"].as<std::string>();
   periodic_metric_output_file_ = result["periodic-output"].as<std::string>();
+  e2e_output_file_ = result["e2e-output"].as<std::string>();
   rw_ratio_ = result["ratio"].as<double>();
   sample_rate_ = result["sample-rate"].as<size_t>();
   use_cache_ring_ = result["cache-ring"].as<bool>();
 
+  std::string queue_mode = result["queue-mode"].as<std::string>();
+  if (queue_mode == "mpsc")
+  {
+    queue_mode_ = RingBufferMode::MPSC;
+  }
+  else if (queue_mode == "spsc")
+  {
+    queue_mode_ = RingBufferMode::SPSC;
+  }
+  else
+  {
+    LOG_ERROR("Invalid queue mode: " << queue_mode);
+    return false;
+  }
+
   server_memory_config_.num_tiers = result["num-tiers"].as<size_t>();
   if (server_memory_config_.num_tiers < 2 || server_memory_config_.num_tiers > 3)
   {
@@ -63,6 +124,28 @@ bool ConfigParser::_parseBasicConfig(const cxxopts::ParseResult& result)
   std::string policy_type = result["policy-type"].as<std::string>();
   policy_config_.policy_type = policy_type;
   policy_config_.scan_interval = result["scan-interval"].as<size_t>();
+  policy_config_.scanner_threads = result["scanner-threads"].as<size_t>();
+  policy_config_.scan_chunk_size = result["scan-chunk-size"].as<size_t>();
+  policy_config_.scan_rate = result["scan-rate"].as<size_t>();
+  policy_config_.scan_cpu_budget = result["scan-cpu-budget"].as<double>();
+  if (policy_config_.scanner_threads == 0 || policy_config_.scan_chunk_size == 0 || policy_config_.scan_cpu_budget <= 0 ||
+    policy_config_.scan_cpu_budget > 100)
+  {
+    LOG_ERROR("Scanner threads and scan chunk size must be at least 1, the CPU budget in (0, 100]");
+    return false;
+  }
+  policy_config_.half_life_ms = result["half-life"].as<size_t>();
+  policy_config_.adaptive_thresholds = result["adaptive-thresholds"].as<bool>();
+  policy_config_.migration_batch_size = result["migration-batch-size"].as<size_t>();
+  policy_config_.migration_flush_interval_ms = result["migration-flush-interval"].as<size_t>();
+  policy_config_.migration_threads = result["migration-threads"].as<size_t>();
+  policy_config_.migration_queue_size = result["migration-queue-size"].as<size_t>();
+  if (policy_config_.migration_batch_size == 0 || policy_config_.migration_threads == 0 ||
+    policy_config_.migration_queue_size == 0)
+  {
+    LOG_ERROR("Migration batch size, threads and queue size must be at least 1");
+    return false;
+  }
 
   if (policy_type == "lru")
   {
@@ -107,6 +190,139 @@ bool ConfigParser::_parseServerConfig(const cxxopts::ParseResult& result) {
   server_memory_config_.remote_numa.capacity =
     (server_memory_config_.num_tiers == 3) ? mem_sizes[1] : 0;
   server_memory_config_.pmem.capacity = mem_sizes.back();
+
+  std::string backend = result["tier-backend"].as<std::string>();
+  if (backend == "numa") {
+    server_memory_config_.backend.type = TierBackendType::NUMA;
+  }
+  else if (backend == "emulated") {
+    server_memory_config_.backend.type = TierBackendType::EMULATED;
+  }
+  else {
+    LOG_ERROR("Invalid tier backend: " << backend);
+    return false;
+  }
+
+  std::string content = result["content"].as<std::string>();
+  if (content == "zero") {
+    server_memory_config_.content = ContentType::ZERO;
+  }
+  else if (content == "random") {
+    server_memory_config_.content = ContentType::RANDOM;
+  }
+  else if (content == "pattern") {
+    server_memory_config_.content = ContentType::PATTERN;
+  }
+  else {
+    LOG_ERROR("Invalid content type: " << content);
+    return false;
+  }
+  server_memory_config_.init_threads = result["init-threads"].as<size_t>();
+
+  std::string hotness_source = result["hotness-source"].as<std::string>();
+  if (hotness_source == "software") {
+    server_memory_config_.hotness_source = HotnessSource::SOFTWARE;
+  }
+  else if (hotness_source == "idle-bitmap") {
+    server_memory_config_.hotness_source = HotnessSource::IDLE_BITMAP;
+  }
+  else {
+    LOG_ERROR("Invalid hotness source: " << hotness_source);
+    return false;
+  }
+
+  std::string clock_source = result["clock-source"].as<std::string>();
+  if (clock_source == "steady") {
+    server_memory_config_.clock_source = ClockSource::STEADY;
+  }
+  else if (clock_source == "coarse") {
+    server_memory_config_.clock_source = ClockSource::COARSE;
+  }
+  else if (clock_source == "ticker") {
+    server_memory_config_.clock_source = ClockSource::TICKER;
+  }
+  else {
+    LOG_ERROR("Invalid clock source: " << clock_source);
+    return false;
+  }
+
+  std::string migration_unit = result["migration-unit"].as<std::string>();
+  if (migration_unit == "page") {
+    server_memory_config_.migration_unit = MigrationUnit::PAGE;
+  }
+  else if (migration_unit == "region") {
+    server_memory_config_.migration_unit = MigrationUnit::REGION;
+  }
+  else {
+    LOG_ERROR("Invalid migration unit: " << migration_unit);
+    return false;
+  }
+  server_memory_config_.region_density = result["region-density"].as<size_t>();
+  if (server_memory_config_.region_density > 100) {
+    LOG_ERROR("Region density must be a percentage (0-100)");
+    return false;
+  }
+  // Ring eviction picks single pages, which would split regions
+  if (server_memory_config_.migration_unit == MigrationUnit::REGION && use_cache_ring_) {
+    LOG_ERROR("--cache-ring is not supported with --migration-unit region");
+    return false;
+  }
+
+  std::string huge_pages = result["huge-pages"].as<std::string>();
+  if (huge_pages == "none") {
+    server_memory_config_.huge_page_policy = HugePagePolicy::NONE;
+  }
+  else if (huge_pages == "all") {
+    server_memory_config_.huge_page_policy = HugePagePolicy::ALL;
+  }
+  else if (huge_pages == "hot") {
+    server_memory_config_.huge_page_policy = HugePagePolicy::HOT;
+  }
+  else {
+    LOG_ERROR("Invalid huge page policy: " << huge_pages);
+    return false;
+  }
+  server_memory_config_.huge_page_density = result["huge-page-density"].as<size_t>();
+  if (server_memory_config_.huge_page_density > 100) {
+    LOG_ERROR("Huge page density must be a percentage (0-100)");
+    return false;
+  }
+
+  size_t clock_max_count = result["clock-max-count"].as<size_t>();
+  if (clock_max_count == 0 || clock_max_count > ClockRing::MAX_COUNT) {
+    LOG_ERROR("Clock max count must be between 1 and " << ClockRing::MAX_COUNT);
+    return false;
+  }
+  server_memory_config_.clock_max_count = static_cast<uint32_t>(clock_max_count);
+
+  std::string latency_timer = result["latency-timer"].as<std::string>();
+  if (latency_timer == "clock") {
+    server_memory_config_.latency_timer = LatencyTimerSource::CLOCK;
+  }
+  else if (latency_timer == "tsc") {
+    server_memory_config_.latency_timer = LatencyTimerSource::TSC;
+  }
+  else {
+    LOG_ERROR("Invalid latency timer: " << latency_timer);
+    return false;
+  }
+
+  // Per-tier cost model, laid out like mem-sizes
+  const char* cost_options[] = { "emulated-latency", "emulated-bandwidth" };
+  size_t* cost_fields[] = { server_memory_config_.backend.latency_ns,
+                            server_memory_config_.backend.bandwidth_mbps };
+  for (size_t i = 0; i < 2; i++) {
+    auto costs = result[cost_options[i]].as<std::vector<size_t>>();
+    if (result.count(cost_options[i]) && costs.size() != server_memory_config_.num_tiers) {
+      LOG_ERROR(cost_options[i] << " must have exactly "
+        << server_memory_config_.num_tiers << " values");
+      return false;
+    }
+    cost_fields[i][static_cast<size_t>(PageLayer::NUMA_LOCAL)] = costs[0];
+    cost_fields[i][static_cast<size_t>(PageLayer::NUMA_REMOTE)] =
+      (server_memory_config_.num_tiers == 3) ? costs[1] : 0;
+    cost_fields[i][static_cast<size_t>(PageLayer::PMEM)] = costs.back();
+  }
   return true;
 }
 
@@ -148,6 +364,37 @@ bool ConfigParser::_parseClientConfigs(const cxxopts::ParseResult& result) {
     }
     config.zipf_s = result["zipfs"].as<double>();
 
+    config.load.target_rate = result["target-rate"].as<double>();
+    if (config.load.target_rate < 0) {
+      LOG_ERROR("Target rate must not be negative");
+      return false;
+    }
+    std::string arrival = result["arrival"].as<std::string>();
+    if (arrival == "poisson") {
+      config.load.arrival = ArrivalProcess::POISSON;
+    }
+    else if (arrival == "constant") {
+      config.load.arrival = ArrivalProcess::CONSTANT;
+    }
+    else {
+      LOG_ERROR("Invalid arrival process: " << arrival);
+      return false;
+    }
+
+    std::string record_trace = result["record-trace"].as<std::string>();
+    std::string replay_trace = result["replay-trace"].as<std::string>();
+    if (!record_trace.empty() && !replay_trace.empty()) {
+      LOG_ERROR("Cannot record and replay traces in the same run");
+      return false;
+    }
+    if (!record_trace.empty()) {
+      config.trace.record_path = record_trace + "." + std::to_string(i);
+    }
+    if (!replay_trace.empty()) {
+      config.trace.replay_path = replay_trace + "." + std::to_string(i);
+    }
+    config.trace.replay_timing = result["replay-timing"].as<bool>();
+
     client_configs_.push_back(config);
   }
   return true;
@@ -170,6 +417,13 @@ bool ConfigParser::parse(int argc, char* argv[]) {
     return false;
   }
 
+  // Clients are the unit of partitioning, extra manager threads would idle
+  if (manager_threads_ > client_configs_.size()) {
+    LOG_WARN("Manager threads (" << manager_threads_ << ") exceed clients ("
+      << client_configs_.size() << "), using " << client_configs_.size());
+    manager_threads_ = client_configs_.size();
+  }
+
   _printConfig();
   return true;
 }
@@ -210,12 +464,27 @@ bool ConfigParser::_validateMemoryConfiguration() {
 void ConfigParser::_printConfig() const {
   LOG_INFO("========== Configuration Parameters ==========");
   LOG_INFO("Buffer Size: " << buffer_size_);
+  LOG_INFO("Batch Size: " << batch_size_);
+  LOG_INFO("Manager Threads: " << manager_threads_);
+  LOG_INFO("Queue Mode: " << (queue_mode_ == RingBufferMode::SPSC ? "spsc" : "mpsc"));
   LOG_INFO("Running Time: " << running_time_ << " seconds");
   LOG_INFO("Read/Write Ratio: " << rw_ratio_);
   LOG_INFO("Sample Rate: " << sample_rate_);
 
   LOG_INFO("Migration Page Policy Type: " << policy_config_.policy_type);
   LOG_INFO("Scan Interval: " << policy_config_.scan_interval);
+  LOG_INFO("Scanner Threads: " << policy_config_.scanner_threads);
+  LOG_INFO("Scan Chunk Size: " << policy_config_.scan_chunk_size);
+  LOG_INFO("Scan Rate: " << (policy_config_.scan_rate
+    ? std::to_string(policy_config_.scan_rate) + " pages/s" : std::string("one round per interval")));
+  LOG_INFO("Scan CPU Budget: " << policy_config_.scan_cpu_budget << "%");
+  LOG_INFO("Access Count Half-Life: " << (policy_config_.half_life_ms
+    ? std::to_string(policy_config_.half_life_ms) + " ms" : std::string("none")));
+  LOG_INFO("Adaptive Thresholds: " << policy_config_.adaptive_thresholds);
+  LOG_INFO("Migration Batch Size: " << policy_config_.migration_batch_size);
+  LOG_INFO("Migration Threads: " << policy_config_.migration_threads);
+  LOG_INFO("Migration Queue Size: " << policy_config_.migration_queue_size);
+  LOG_INFO("Migration Flush Interval: " << policy_config_.migration_flush_interval_ms << " ms");
 
   if (policy_config_.policy_type == "lru") {
     auto& lru = std::get<LRUPolicyConfig>(policy_config_.config);
@@ -250,6 +519,49 @@ void ConfigParser::_printConfig() const {
       << *sizes[i] << " pages");
   }
   LOG_INFO("  - Cache Ring: ") << use_cache_ring_;
+  if (use_cache_ring_) {
+    LOG_INFO("  - Clock Max Count: " << server_memory_config_.clock_max_count);
+  }
+
+  const char* content_names[] = { "zero", "random", "pattern" };
+  LOG_INFO("Initial Content: " << content_names[static_cast<size_t>(server_memory_config_.content)]);
+  LOG_INFO("Init Threads: " << (server_memory_config_.init_threads
+    ? std::to_string(server_memory_config_.init_threads) : std::string("all CPUs")));
+  LOG_INFO("Hotness Source: " << (server_memory_config_.hotness_source == HotnessSource::IDLE_BITMAP
+    ? "idle-bitmap" : "software"));
+  const char* clock_names[] = { "steady", "coarse", "ticker" };
+  LOG_INFO("Clock Source: " << clock_names[static_cast<size_t>(server_memory_config_.clock_source)]);
+  LOG_INFO("Latency Timer: " << (server_memory_config_.latency_timer == LatencyTimerSource::TSC
+    ? "tsc" : "clock"));
+  if (server_memory_config_.migration_unit == MigrationUnit::REGION) {
+    LOG_INFO("Migration Unit: region (2 MB), whole-region moves at "
+      << server_memory_config_.region_density << "% density");
+  }
+  else {
+    LOG_INFO("Migration Unit: page");
+  }
+
+  if (server_memory_config_.huge_page_policy == HugePagePolicy::HOT) {
+    LOG_INFO("Huge Pages: hot ranges at " << server_memory_config_.huge_page_density << "% density");
+  }
+  else {
+    LOG_INFO("Huge Pages: " << (server_memory_config_.huge_page_policy == HugePagePolicy::ALL
+      ? "all" : "none"));
+  }
+
+  const TierBackendConfig& backend = server_memory_config_.backend;
+  LOG_INFO("Tier Backend: " << (backend.type == TierBackendType::EMULATED ? "emulated" : "numa"));
+  if (backend.type == TierBackendType::EMULATED) {
+    for (PageLayer layer : { PageLayer::NUMA_LOCAL, PageLayer::NUMA_REMOTE, PageLayer::PMEM }) {
+      if (layer == PageLayer::NUMA_REMOTE && server_memory_config_.num_tiers == 2) {
+        continue;
+      }
+      size_t tier = static_cast<size_t>(layer);
+      LOG_INFO("  - " << layer << ": +" << backend.latency_ns[tier] << " ns, "
+        << (backend.bandwidth_mbps[tier] ? std::to_string(backend.bandwidth_mbps[tier]) + " MB/s"
+          : std::string("unlimited")));
+    }
+  }
 
   LOG_INFO("Client Configurations:");
   for (size_t i = 0; i < client_configs_.size(); i++) {
@@ -261,6 +573,19 @@ void ConfigParser::_printConfig() const {
     if (client_configs_[i].pattern == AccessPattern::ZIPFIAN) {
       LOG_INFO("    - Zipfs: " << client_configs_[i].zipf_s);
     }
+    const LoadConfig& load = client_configs_[i].load;
+    if (load.target_rate > 0) {
+      LOG_INFO("    - Target Rate: " << load.target_rate << " req/s ("
+        << (load.arrival == ArrivalProcess::POISSON ? "poisson" : "constant") << ")");
+    }
+    const TraceConfig& trace = client_configs_[i].trace;
+    if (!trace.record_path.empty()) {
+      LOG_INFO("    - Record Trace: " << trace.record_path);
+    }
+    if (!trace.replay_path.empty()) {
+      LOG_INFO("    - Replay Trace: " << trace.replay_path
+        << (trace.replay_timing ? " (recorded timing)" : " (full speed)"));
+    }
     for (size_t j = 0; j < client_configs_[i].tier_sizes.size(); j++) {
       LOG_INFO("    - " << _getTierName(j, server_memory_config_.num_tiers)
         << ": " << client_configs_[i].tier_sizes[j] << " pages");
@@ -1,83 +1,167 @@
 #include "ClockRing.hpp"
 
-ClockRing::ClockRing(size_t capacity) : hand_(nullptr), size_(0), capacity_(capacity) {}
-
-ClockRing::~ClockRing() {
-    while (size_ > 0) {
-        ClockRingNode* node = hand_;
-        hand_ = hand_->next;
-        delete node;
-        size_--;
+ClockRing::ClockRing(size_t capacity, uint32_t max_count)
+    : slot_page_(capacity), slot_state_(capacity), lanes_((capacity + 7) / 8),
+      free_next_(capacity), free_head_(NO_SLOT), hand_(0), size_(0), capacity_(capacity),
+      max_count_(max_count) {
+    assert(capacity < NO_SLOT && "Clock ring capacity exceeds slot index range");
+    assert(max_count >= 1 && max_count <= MAX_COUNT && "Clock ring max count out of range");
+    for (size_t i = 0; i < lanes_.size(); i++)
+        lanes_[i].store(0, std::memory_order_relaxed);
+    // Low slots on top, so a filling ring is dense from slot 0
+    for (size_t i = 0; i < capacity; i++) {
+        slot_page_[i].store(0, std::memory_order_relaxed);
+        slot_state_[i].store(0, std::memory_order_relaxed);
+        free_next_[i].store(i + 1 < capacity ? static_cast<uint32_t>(i + 1) : NO_SLOT,
+            std::memory_order_relaxed);
     }
-    hand_ = nullptr;
+    free_head_.store(capacity ? 0 : NO_SLOT, std::memory_order_relaxed);
 }
 
-bool ClockRing::insert(size_t page_id, ClockRingNode*& out_ptr) {
-    if (size_ >= capacity_) return false;
+bool ClockRing::insert(size_t page_id, std::atomic<Handle>& handle) {
+    uint32_t slot;
+    if (!_popFree(slot)) return false;
 
-    ClockRingNode* node = new ClockRingNode(page_id);
-    out_ptr = node;
+    // Counted before it is visible, an evictor never takes size below zero
+    size_.fetch_add(1, std::memory_order_relaxed);
+    slot_page_[slot].store(page_id, std::memory_order_relaxed);
+    uint32_t generation = slot_state_[slot].load(std::memory_order_relaxed) >> 1;
+    handle.store(_handle(generation, slot), std::memory_order_relaxed);
 
-    if (!hand_) {
-        hand_ = node->next = node->prev = node;
-    }
-    // insert before the hand, as the tail of the ring
-    else {
-        ClockRingNode* tail = hand_->prev;
-        tail->next = node;
-        node->prev = tail;
-        node->next = hand_;
-        hand_->prev = node;
+    // Publish: whoever sees LIVE also sees the page and the handle
+    slot_state_[slot].store((generation << 1) | LIVE, std::memory_order_release);
+
+    // Occupied at count zero, dropping any stale mark since the release
+    std::atomic<uint64_t>& lanes = lanes_[slot / 8];
+    unsigned shift = (slot % 8) * 8;
+    uint64_t word = lanes.load(std::memory_order_relaxed);
+    while (!lanes.compare_exchange_weak(word, (word & ~(0xFFULL << shift)) | (OCCUPIED << shift),
+        std::memory_order_release, std::memory_order_relaxed)) {
     }
+    return true;
+}
 
-    ++size_;
+bool ClockRing::remove(Handle handle) {
+    assert(handle != NO_HANDLE && "Cannot remove an empty handle");
+
+    uint32_t slot = _slotOf(handle);
+    uint32_t expected = (static_cast<uint32_t>(handle >> 32) << 1) | LIVE;
+    if (!_claim(slot, expected)) return false;
+    _release(slot);
     return true;
 }
 
-void ClockRing::remove(ClockRingNode*& node_ptr) {
-    assert(node_ptr && "Cannot remove nullptr");
+bool ClockRing::findEvictionCandidate(size_t& page_id, Handle& handle) {
+    // A turn decrements every count it passes, so max_count + 1 turns find
+    // a victim unless other threads keep marking or emptying the ring. Lost
+    // hand races count, they mean another evictor moved the hand.
+    size_t words = lanes_.size();
+    for (size_t step = 0; step < 2 * (max_count_ + 1) * (words + 1); step++) {
+        if (size_.load(std::memory_order_relaxed) == 0) return false;
 
-    if (node_ptr->next == node_ptr) {
-        hand_ = nullptr;
-    }
-    else {
-        node_ptr->prev->next = node_ptr->next;
-        node_ptr->next->prev = node_ptr->prev;
-        if (hand_ == node_ptr)
-            hand_ = node_ptr->next;
+        size_t hand = hand_.load(std::memory_order_relaxed);
+        size_t index = hand / 8;
+        uint64_t from_hand = LANE_TOPS & (~0ULL << ((hand % 8) * 8));
+        uint64_t word = lanes_[index].load(std::memory_order_acquire);
+        uint64_t counted = _counted(word);
+        uint64_t candidates = word & from_hand & ~counted;
+
+        if (!candidates) {
+            // Take the rest of the word, every page in it loses a count
+            size_t next = index + 1 < words ? (index + 1) * 8 : 0;
+            if (hand_.compare_exchange_weak(hand, next, std::memory_order_relaxed) &&
+                (counted & from_hand))
+                _decrement(index, from_hand);
+            continue;
+        }
+
+        uint32_t slot = static_cast<uint32_t>(index * 8 + __builtin_ctzll(candidates) / 8);
+        size_t next = slot + 1 < capacity_ ? slot + 1 : 0;
+        if (!hand_.compare_exchange_weak(hand, next, std::memory_order_relaxed))
+            continue;
+
+        // The pages before the victim lose a count
+        uint64_t passed = from_hand & ((1ULL << ((slot % 8) * 8)) - 1);
+        if (counted & passed)
+            _decrement(index, passed);
+
+        // The lane may be stale, the page removed or evicted meanwhile
+        uint32_t state = slot_state_[slot].load(std::memory_order_acquire);
+        if (!(state & LIVE)) continue;
+        size_t victim = slot_page_[slot].load(std::memory_order_relaxed);
+        if (!_claim(slot, state)) continue;
+
+        page_id = victim;
+        handle = _handle(state >> 1, slot);
+        _release(slot);
+        return true;
     }
+    return false;
+}
 
-    delete node_ptr;
-    node_ptr = nullptr;
-    --size_;
+void ClockRing::_decrement(size_t index, uint64_t lanes) {
+    // A CAS rather than fetch_sub: a lane released since the load holds
+    // zero, subtracting from it would borrow from its neighbour
+    uint64_t word = lanes_[index].load(std::memory_order_relaxed);
+    while (true) {
+        uint64_t ones = (_counted(word) & lanes) >> 7;
+        if (!ones) return;
+        if (lanes_[index].compare_exchange_weak(word, word - ones,
+            std::memory_order_relaxed, std::memory_order_relaxed))
+            return;
+    }
 }
 
-void ClockRing::markAccessed(ClockRingNode* node) {
-    if (node) node->ref_bit.store(true, std::memory_order_relaxed);
+bool ClockRing::_claim(uint32_t slot, uint32_t expected) {
+    // Moving to the next generation retires every handle to this page
+    return slot_state_[slot].compare_exchange_strong(expected, ((expected >> 1) + 1) << 1,
+        std::memory_order_acq_rel, std::memory_order_relaxed);
 }
 
-size_t ClockRing::findEvictionCandidate() {
-    assert(hand_ && "Clock ring is empty");
+void ClockRing::_release(uint32_t slot) {
+    lanes_[slot / 8].fetch_and(~(0xFFULL << ((slot % 8) * 8)), std::memory_order_relaxed);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    _pushFree(slot);
+}
 
+bool ClockRing::_popFree(uint32_t& slot) {
+    uint64_t head = free_head_.load(std::memory_order_acquire);
     while (true) {
-        if (!hand_->ref_bit.load(std::memory_order_relaxed)) {
-            size_t victim = hand_->page_id;
-            ClockRingNode* evicted = hand_;
-            hand_ = hand_->next;
-            remove(evicted);
-            return victim;
-        }
-        else {
-            hand_->ref_bit.store(false, std::memory_order_relaxed);
-            hand_ = hand_->next;
+        uint32_t top = static_cast<uint32_t>(head);
+        if (top == NO_SLOT) return false;
+        uint64_t tag = (head >> 32) + 1;
+        uint32_t next = free_next_[top].load(std::memory_order_relaxed);
+        if (free_head_.compare_exchange_weak(head, (tag << 32) | next,
+            std::memory_order_acquire, std::memory_order_acquire)) {
+            slot = top;
+            return true;
         }
     }
 }
 
+void ClockRing::_pushFree(uint32_t slot) {
+    uint64_t head = free_head_.load(std::memory_order_relaxed);
+    while (true) {
+        free_next_[slot].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        uint64_t tag = (head >> 32) + 1;
+        if (free_head_.compare_exchange_weak(head, (tag << 32) | slot,
+            std::memory_order_release, std::memory_order_relaxed))
+            return;
+    }
+}
+
 size_t ClockRing::size() const {
-    return size_;
+    return size_.load(std::memory_order_relaxed);
 }
 
 bool ClockRing::empty() const {
-    return size_ == 0;
-}
\ No newline at end of file
+    return size() == 0;
+}
+
+size_t ClockRing::capacity() const {
+    return capacity_;
+}
+
+uint32_t ClockRing::maxCount() const {
+    return max_count_;
+}
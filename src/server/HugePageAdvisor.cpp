@@ -0,0 +1,248 @@
+#include "HugePageAdvisor.hpp"
+
+#include <algorithm>
+
+// Linux 6.1, older headers lack it
+#ifndef MADV_COLLAPSE
+#define MADV_COLLAPSE 25
+#endif
+
+namespace {
+
+const char* SMAPS_PATH = "/proc/self/smaps";
+
+// Ranges MADV_COLLAPSE may copy per round, 128 MB of synchronous copying
+constexpr size_t COLLAPSE_BUDGET = 64;
+
+constexpr size_t RANGE_PAGES = HUGE_PAGE_SIZE / PAGE_SIZE;
+
+} // namespace
+
+HugePageAdvisor::HugePageAdvisor(size_t density_percent)
+  : promote_pages_((RANGE_PAGES * density_percent + 99) / 100),
+  demote_pages_(promote_pages_ / 2)
+{
+}
+
+void HugePageAdvisor::addTier(PageLayer layer, void* base, size_t bytes)
+{
+  // Only whole ranges can hold a huge page, a partial last range is left alone
+  Tier tier;
+  tier.layer = layer;
+  tier.base = reinterpret_cast<uintptr_t>(base);
+  tier.ranges.resize(bytes / HUGE_PAGE_SIZE);
+  tier.bytes = tier.ranges.size() * HUGE_PAGE_SIZE;
+  tier.stats.ranges = tier.ranges.size();
+  if (tier.base % HUGE_PAGE_SIZE != 0)
+  {
+    LOG_WARN("Tier " << layer << " is not huge page aligned, huge page advice disabled for it");
+    return;
+  }
+  if (!tier.ranges.empty())
+  {
+    tiers_.push_back(std::move(tier));
+  }
+}
+
+const HugePageAdvisor::TierStats& HugePageAdvisor::stats(PageLayer layer) const
+{
+  static const TierStats none;
+  for (const Tier& tier : tiers_)
+  {
+    if (tier.layer == layer)
+    {
+      return tier.stats;
+    }
+  }
+  return none;
+}
+
+void HugePageAdvisor::finishRound()
+{
+  for (Tier& tier : tiers_)
+  {
+    tier.stats.promoted = 0;
+    tier.stats.demoted = 0;
+    tier.stats.collapsed = 0;
+    _advise(tier);
+  }
+
+  // Tiers were added fastest first, the local tier gets the budget first
+  size_t budget = COLLAPSE_BUDGET;
+  for (Tier& tier : tiers_)
+  {
+    if (collapse_supported_)
+    {
+      _collapse(tier, budget);
+    }
+  }
+
+  _readBacking();
+  for (Tier& tier : tiers_)
+  {
+    tier.stats.huge_ranges = 0;
+    tier.stats.no_huge_ranges = 0;
+    tier.stats.backed_ranges = 0;
+    for (const RangeState& range : tier.ranges)
+    {
+      tier.stats.huge_ranges += range.advice == Advice::HUGE;
+      tier.stats.no_huge_ranges += range.advice == Advice::NO_HUGE;
+      tier.stats.backed_ranges += range.advice == Advice::HUGE && range.backed;
+    }
+  }
+}
+
+void HugePageAdvisor::_advise(Tier& tier)
+{
+  // Wanted advice of each range, DEFAULT where it stays as it is
+  size_t run_start = 0;
+  Advice run_advice = Advice::DEFAULT;
+  for (size_t i = 0; i <= tier.ranges.size(); i++)
+  {
+    Advice want = Advice::DEFAULT;
+    if (i < tier.ranges.size())
+    {
+      RangeState& range = tier.ranges[i];
+      if (range.foreign || range.accessed < demote_pages_)
+      {
+        want = Advice::NO_HUGE;
+      }
+      else if (range.accessed >= promote_pages_)
+      {
+        want = Advice::HUGE;
+      }
+      if (want == range.advice)
+      {
+        want = Advice::DEFAULT;
+      }
+      range.accessed = 0;
+      range.foreign = false;
+    }
+
+    // Issue the run of equal changes this range does not extend
+    if (want != run_advice)
+    {
+      if (run_advice != Advice::DEFAULT)
+      {
+        _madvise(tier, run_start, i, run_advice);
+      }
+      run_start = i;
+      run_advice = want;
+    }
+  }
+}
+
+bool HugePageAdvisor::_madvise(Tier& tier, size_t first, size_t end, Advice advice)
+{
+  void* addr = reinterpret_cast<void*>(tier.base + first * HUGE_PAGE_SIZE);
+  int behavior = advice == Advice::HUGE ? MADV_HUGEPAGE : MADV_NOHUGEPAGE;
+  if (madvise(addr, (end - first) * HUGE_PAGE_SIZE, behavior) != 0)
+  {
+    // ENOMEM once the advice splits the mapping past vm.max_map_count
+    LOG_DEBUG("madvise(" << (advice == Advice::HUGE ? "MADV_HUGEPAGE" : "MADV_NOHUGEPAGE")
+      << ") failed on " << end - first << " ranges of " << tier.layer << ": " << strerror(errno));
+    return false;
+  }
+  for (size_t i = first; i < end; i++)
+  {
+    tier.ranges[i].advice = advice;
+  }
+  (advice == Advice::HUGE ? tier.stats.promoted : tier.stats.demoted) += end - first;
+  return true;
+}
+
+void HugePageAdvisor::_collapse(Tier& tier, size_t& budget)
+{
+  for (size_t i = 0; i < tier.ranges.size() && budget > 0; i++)
+  {
+    RangeState& range = tier.ranges[i];
+    if (range.advice != Advice::HUGE || range.backed)
+    {
+      continue;
+    }
+    budget--;
+    void* addr = reinterpret_cast<void*>(tier.base + i * HUGE_PAGE_SIZE);
+    if (madvise(addr, HUGE_PAGE_SIZE, MADV_COLLAPSE) == 0)
+    {
+      range.backed = true;
+      tier.stats.collapsed++;
+    }
+    else if (errno == EINVAL)
+    {
+      // Before Linux 6.1, khugepaged alone collapses advised ranges
+      LOG_INFO("MADV_COLLAPSE unsupported, huge pages come from khugepaged only");
+      collapse_supported_ = false;
+      return;
+    }
+    // EAGAIN and ENOMEM are transient, the range is retried next round
+  }
+}
+
+void HugePageAdvisor::_readBacking()
+{
+  for (Tier& tier : tiers_)
+  {
+    tier.stats.huge_pages = 0;
+  }
+
+  FILE* smaps = fopen(SMAPS_PATH, "r");
+  if (!smaps)
+  {
+    LOG_DEBUG("Cannot open " << SMAPS_PATH << ": " << strerror(errno));
+    return;
+  }
+  char line[256];
+  unsigned long start = 0;
+  unsigned long end = 0;
+  unsigned long vma_start, vma_end;
+  size_t huge_kb;
+  while (fgets(line, sizeof(line), smaps))
+  {
+    // A mapping header, then its fields
+    if (sscanf(line, "%lx-%lx ", &vma_start, &vma_end) == 2)
+    {
+      start = vma_start;
+      end = vma_end;
+    }
+    else if (sscanf(line, "AnonHugePages: %zu kB", &huge_kb) == 1)
+    {
+      _countRun(start, end, huge_kb);
+    }
+  }
+  fclose(smaps);
+}
+
+void HugePageAdvisor::_countRun(uintptr_t start, uintptr_t end, size_t huge_kb)
+{
+  size_t huge_pages = huge_kb * 1024 / HUGE_PAGE_SIZE;
+  size_t run_ranges = (end - start) / HUGE_PAGE_SIZE;
+  for (Tier& tier : tiers_)
+  {
+    uintptr_t first = std::max(start, tier.base);
+    uintptr_t last = std::min(end, tier.base + tier.bytes);
+    if (first >= last)
+    {
+      continue;
+    }
+    // A mapping merged across tiers splits its huge pages by size
+    size_t ranges = (last - first) / HUGE_PAGE_SIZE;
+    tier.stats.huge_pages += run_ranges ? huge_pages * ranges / run_ranges : 0;
+
+    // Fully backed, or fewer huge pages than ranges known backed: some
+    // were split, which ones is unknown, so all are collapsed again
+    size_t first_range = (first - tier.base + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE;
+    size_t end_range = (last - tier.base) / HUGE_PAGE_SIZE;
+    size_t known = 0;
+    for (size_t i = first_range; i < end_range; i++)
+    {
+      known += tier.ranges[i].backed;
+    }
+    if (huge_pages >= run_ranges || huge_pages < known)
+    {
+      for (size_t i = first_range; i < end_range; i++)
+      {
+        tier.ranges[i].backed = huge_pages >= run_ranges;
+      }
+    }
+  }
+}
@@ -0,0 +1,146 @@
+#include "IdlePageTracker.hpp"
+
+#include <algorithm>
+
+namespace {
+
+const char* PAGEMAP_PATH = "/proc/self/pagemap";
+const char* IDLE_BITMAP_PATH = "/sys/kernel/mm/page_idle/bitmap";
+
+constexpr uint64_t PAGEMAP_PRESENT = 1ULL << 63;
+constexpr uint64_t PAGEMAP_PFN_MASK = (1ULL << 55) - 1;
+
+// pagemap entries read per pread, 4KB of entries
+constexpr size_t PAGEMAP_BATCH = 512;
+// Bitmap words read per pread, covers 32768 frames
+constexpr size_t BITMAP_BATCH = 512;
+
+} // namespace
+
+IdlePageTracker::IdlePageTracker()
+  : pagemap_window_(PAGEMAP_BATCH)
+{
+  pagemap_fd_ = open(PAGEMAP_PATH, O_RDONLY);
+  if (pagemap_fd_ < 0)
+  {
+    LOG_WARN("Idle page tracking unavailable, cannot open " << PAGEMAP_PATH
+      << ": " << strerror(errno));
+    return;
+  }
+  bitmap_fd_ = open(IDLE_BITMAP_PATH, O_RDWR);
+  if (bitmap_fd_ < 0)
+  {
+    LOG_WARN("Idle page tracking unavailable, cannot open " << IDLE_BITMAP_PATH
+      << ": " << strerror(errno));
+    _close();
+    return;
+  }
+
+  // Without CAP_SYS_ADMIN pagemap reports zero frame numbers
+  uint64_t probe = 1;
+  uint64_t frame = _frameOf(reinterpret_cast<uintptr_t>(&probe) / PAGE_SIZE);
+  uint64_t word;
+  if (frame == 0 || pread(bitmap_fd_, &word, sizeof(word), frame / 64 * sizeof(word)) != sizeof(word))
+  {
+    LOG_WARN("Idle page tracking unavailable, frame numbers are hidden (needs CAP_SYS_ADMIN)");
+    _close();
+  }
+}
+
+IdlePageTracker::~IdlePageTracker()
+{
+  _close();
+}
+
+void IdlePageTracker::_close()
+{
+  if (pagemap_fd_ >= 0)
+  {
+    close(pagemap_fd_);
+    pagemap_fd_ = -1;
+  }
+  if (bitmap_fd_ >= 0)
+  {
+    close(bitmap_fd_);
+    bitmap_fd_ = -1;
+  }
+}
+
+uint64_t IdlePageTracker::_frameOf(uintptr_t vpn)
+{
+  // Pages of a tier are mostly adjacent, refill the window only on a miss
+  if (vpn < window_start_ || vpn >= window_start_ + window_count_)
+  {
+    ssize_t bytes = pread(pagemap_fd_, pagemap_window_.data(),
+      PAGEMAP_BATCH * sizeof(uint64_t), vpn * sizeof(uint64_t));
+    window_start_ = vpn;
+    window_count_ = bytes > 0 ? bytes / sizeof(uint64_t) : 0;
+    if (window_count_ == 0)
+    {
+      return 0;
+    }
+  }
+  uint64_t entry = pagemap_window_[vpn - window_start_];
+  return (entry & PAGEMAP_PRESENT) ? entry & PAGEMAP_PFN_MASK : 0;
+}
+
+void IdlePageTracker::sample(const std::vector<void*>& pages, std::vector<uint8_t>& accessed)
+{
+  accessed.assign(pages.size(), 0);
+  if (!available())
+  {
+    return;
+  }
+
+  // Mappings change between samples, start with an empty window
+  window_count_ = 0;
+  frames_.clear();
+  for (size_t i = 0; i < pages.size(); i++)
+  {
+    uint64_t frame = _frameOf(reinterpret_cast<uintptr_t>(pages[i]) / PAGE_SIZE);
+    if (frame != 0)
+    {
+      frames_.emplace_back(frame, i);
+    }
+  }
+  std::sort(frames_.begin(), frames_.end());
+
+  // Walk the bitmap in runs of nearby words: read the idle bits, then write
+  // ones for every tracked frame to arm the next sample
+  size_t begin = 0;
+  while (begin < frames_.size())
+  {
+    uint64_t first_word = frames_[begin].first / 64;
+    size_t end = begin;
+    while (end < frames_.size() && frames_[end].first / 64 < first_word + BITMAP_BATCH)
+    {
+      end++;
+    }
+    size_t num_words = frames_[end - 1].first / 64 - first_word + 1;
+    size_t bytes = num_words * sizeof(uint64_t);
+    bitmap_words_.resize(num_words);
+    idle_mask_.assign(num_words, 0);
+
+    if (pread(bitmap_fd_, bitmap_words_.data(), bytes, first_word * sizeof(uint64_t))
+      != static_cast<ssize_t>(bytes))
+    {
+      LOG_DEBUG("Failed to read idle bitmap at frame " << frames_[begin].first);
+      begin = end;
+      continue;
+    }
+    for (size_t i = begin; i < end; i++)
+    {
+      size_t word = frames_[i].first / 64 - first_word;
+      uint64_t bit = 1ULL << (frames_[i].first % 64);
+      accessed[frames_[i].second] = !(bitmap_words_[word] & bit);
+      idle_mask_[word] |= bit;
+    }
+    // Zero bits are ignored by the kernel, frames we do not own stay untouched
+    if (pwrite(bitmap_fd_, idle_mask_.data(), bytes, first_word * sizeof(uint64_t))
+      != static_cast<ssize_t>(bytes))
+    {
+      LOG_DEBUG("Failed to arm idle bitmap at frame " << frames_[begin].first);
+    }
+    begin = end;
+  }
+}
@@ -2,42 +2,44 @@
 
 void Metrics::printMetricsThreeTiers() const
 {
+  CounterSnapshot counters = _aggregateCounters();
   LOG_INFO("======== Memory Access Metrics ========");
   LOG_INFO("Access Counts:");
-  LOG_INFO("  NUMA Local:  " << local_access_count_.load());
-  LOG_INFO("  NUMA Remote: " << remote_access_count_.load());
-  LOG_INFO("  PMEM:        " << pmem_access_count_.load());
-
-  LOG_INFO("Access Latency (ns):");
-  LOG_INFO("  Min:  " << acc::min(access_latency_));
-  LOG_INFO("  P10:  " << acc::extended_p_square(access_latency_)[0]);
-  LOG_INFO("  P20:  " << acc::extended_p_square(access_latency_)[1]);
-  LOG_INFO("  P30:  " << acc::extended_p_square(access_latency_)[2]);
-  LOG_INFO("  P40:  " << acc::extended_p_square(access_latency_)[3]);
-  LOG_INFO("  P50:  " << acc::extended_p_square(access_latency_)[4]);
-  LOG_INFO("  P60:  " << acc::extended_p_square(access_latency_)[5]);
-  LOG_INFO("  P70:  " << acc::extended_p_square(access_latency_)[6]);
-  LOG_INFO("  P80:  " << acc::extended_p_square(access_latency_)[7]);
-  LOG_INFO("  P90:  " << acc::extended_p_square(access_latency_)[8]);
-  LOG_INFO("  Max:  " << acc::max(access_latency_));
-  LOG_INFO("  Mean: " << acc::mean(access_latency_));
+  LOG_INFO("  NUMA Local:  " << counters[LOCAL_ACCESS]);
+  LOG_INFO("  NUMA Remote: " << counters[REMOTE_ACCESS]);
+  LOG_INFO("  PMEM:        " << counters[PMEM_ACCESS]);
+
+  _printLatency(_aggregateLatency());
+  HistogramSnapshot e2e_latency = _aggregateLatency(&CounterShard::end_to_end_latency);
+  if (e2e_latency.count > 0)
+  {
+    _printLatency(e2e_latency, "End-to-End Latency from Scheduled Send (ns):");
+  }
 
   LOG_INFO("Migration Counts:");
-  LOG_INFO("  Local -> Remote: " << local_to_remote_count_.load());
-  LOG_INFO("  Remote -> Local: " << remote_to_local_count_.load());
-  LOG_INFO("  PMEM -> Remote: " << pmem_to_remote_count_.load());
-  LOG_INFO("  Remote -> PMEM: " << remote_to_pmem_count_.load());
-  LOG_INFO("  Local -> PMEM: " << local_to_pmem_count_.load());
-  LOG_INFO("  PMEM -> Local: " << pmem_to_local_count_.load());
+  LOG_INFO("  Local -> Remote: " << counters[LOCAL_TO_REMOTE]);
+  LOG_INFO("  Remote -> Local: " << counters[REMOTE_TO_LOCAL]);
+  LOG_INFO("  PMEM -> Remote: " << counters[PMEM_TO_REMOTE]);
+  LOG_INFO("  Remote -> PMEM: " << counters[REMOTE_TO_PMEM]);
+  LOG_INFO("  Local -> PMEM: " << counters[LOCAL_TO_PMEM]);
+  LOG_INFO("  PMEM -> Local: " << counters[PMEM_TO_LOCAL]);
+  LOG_INFO("  Syscalls: " << counters[MIGRATION_SYSCALL]);
+  LOG_INFO("  Failed: " << counters[MIGRATION_FAILURE]);
+  if (counters[MIGRATION_LATENCY_COUNT] > 0)
+  {
+    LOG_INFO("  Mean Latency (us): " << counters[MIGRATION_LATENCY_TOTAL] / 1000.0 /
+      counters[MIGRATION_LATENCY_COUNT]);
+    LOG_INFO("  Max Latency (us): " << migration_latency_max_.load() / 1000.0);
+  }
 
-  if (total_latency_.load() > 0)
+  if (counters[TOTAL_LATENCY] > 0)
   {
     LOG_INFO("Throughput:");
-    uint64_t total_access = local_access_count_.load() +
-      remote_access_count_.load() +
-      pmem_access_count_.load();
+    uint64_t total_access = counters[LOCAL_ACCESS] +
+      counters[REMOTE_ACCESS] +
+      counters[PMEM_ACCESS];
     double throughput = static_cast<double>(total_access) * 1e9 /
-      static_cast<double>(total_latency_.load());
+      static_cast<double>(counters[TOTAL_LATENCY]);
     LOG_INFO("  Throughput: " << throughput << " ops/sec");
   }
   LOG_INFO("===================================");
@@ -45,42 +47,78 @@ void Metrics::printMetricsThreeTiers() const
 
 void Metrics::printMetricsTwoTiers() const
 {
+  CounterSnapshot counters = _aggregateCounters();
   LOG_INFO("======== Memory Access Metrics (Two Tiers) ========");
   LOG_INFO("Access Counts:");
-  LOG_INFO("  DRAM: " << local_access_count_.load());
-  LOG_INFO("  PMEM: " << pmem_access_count_.load());
-
-  LOG_INFO("Access Latency (ns):");
-  LOG_INFO("  Min:  " << acc::min(access_latency_));
-  LOG_INFO("  P10:  " << acc::extended_p_square(access_latency_)[0]);
-  LOG_INFO("  P20:  " << acc::extended_p_square(access_latency_)[1]);
-  LOG_INFO("  P30:  " << acc::extended_p_square(access_latency_)[2]);
-  LOG_INFO("  P40:  " << acc::extended_p_square(access_latency_)[3]);
-  LOG_INFO("  P50:  " << acc::extended_p_square(access_latency_)[4]);
-  LOG_INFO("  P60:  " << acc::extended_p_square(access_latency_)[5]);
-  LOG_INFO("  P70:  " << acc::extended_p_square(access_latency_)[6]);
-  LOG_INFO("  P80:  " << acc::extended_p_square(access_latency_)[7]);
-  LOG_INFO("  P90:  " << acc::extended_p_square(access_latency_)[8]);
-  LOG_INFO("  Max   " << acc::max(access_latency_));
-  LOG_INFO("  Mean: " << acc::mean(access_latency_));
+  LOG_INFO("  DRAM: " << counters[LOCAL_ACCESS]);
+  LOG_INFO("  PMEM: " << counters[PMEM_ACCESS]);
+
+  _printLatency(_aggregateLatency());
+  HistogramSnapshot e2e_latency = _aggregateLatency(&CounterShard::end_to_end_latency);
+  if (e2e_latency.count > 0)
+  {
+    _printLatency(e2e_latency, "End-to-End Latency from Scheduled Send (ns):");
+  }
 
   LOG_INFO("Migration Counts:");
-  LOG_INFO("  DRAM -> PMEM: " << local_to_pmem_count_.load());
-  LOG_INFO("  PMEM -> DRAM: " << pmem_to_local_count_.load());
+  LOG_INFO("  DRAM -> PMEM: " << counters[LOCAL_TO_PMEM]);
+  LOG_INFO("  PMEM -> DRAM: " << counters[PMEM_TO_LOCAL]);
+  LOG_INFO("  Syscalls: " << counters[MIGRATION_SYSCALL]);
+  LOG_INFO("  Failed: " << counters[MIGRATION_FAILURE]);
+  if (counters[MIGRATION_LATENCY_COUNT] > 0)
+  {
+    LOG_INFO("  Mean Latency (us): " << counters[MIGRATION_LATENCY_TOTAL] / 1000.0 /
+      counters[MIGRATION_LATENCY_COUNT]);
+    LOG_INFO("  Max Latency (us): " << migration_latency_max_.load() / 1000.0);
+  }
 
-  if (total_latency_.load() > 0)
+  if (counters[TOTAL_LATENCY] > 0)
   {
     LOG_INFO("Throughput:");
     uint64_t total_access =
-      local_access_count_.load() + pmem_access_count_.load();
+      counters[LOCAL_ACCESS] + counters[PMEM_ACCESS];
     double throughput = static_cast<double>(total_access) * 1e9 /
-      static_cast<double>(total_latency_.load());
+      static_cast<double>(counters[TOTAL_LATENCY]);
     LOG_INFO("  Throughput: " << throughput << " ops/sec");
   }
   LOG_INFO("==========================================");
 }
 
+void Metrics::_printLatency(const HistogramSnapshot& latency, const char* title) const
+{
+  LOG_INFO(title);
+  LOG_INFO("  Min:    " << (latency.count > 0 ? latency.min : 0));
+  LOG_INFO("  P10:    " << latency.percentile(0.1));
+  LOG_INFO("  P20:    " << latency.percentile(0.2));
+  LOG_INFO("  P30:    " << latency.percentile(0.3));
+  LOG_INFO("  P40:    " << latency.percentile(0.4));
+  LOG_INFO("  P50:    " << latency.percentile(0.5));
+  LOG_INFO("  P60:    " << latency.percentile(0.6));
+  LOG_INFO("  P70:    " << latency.percentile(0.7));
+  LOG_INFO("  P80:    " << latency.percentile(0.8));
+  LOG_INFO("  P90:    " << latency.percentile(0.9));
+  LOG_INFO("  P99:    " << latency.percentile(0.99));
+  LOG_INFO("  P99.9:  " << latency.percentile(0.999));
+  LOG_INFO("  P99.99: " << latency.percentile(0.9999));
+  LOG_INFO("  Max:    " << latency.max);
+  LOG_INFO("  Mean:   " << latency.mean());
+}
+
 void Metrics::outputLatencyCDFToFile(const std::string& filename) const
+{
+  _writeCDF(_aggregateLatency(), filename);
+}
+
+void Metrics::outputEndToEndCDFToFile(const std::string& filename) const
+{
+  HistogramSnapshot e2e_latency = _aggregateLatency(&CounterShard::end_to_end_latency);
+  if (e2e_latency.count > 0)
+  {
+    _writeCDF(e2e_latency, filename);
+  }
+}
+
+void Metrics::_writeCDF(const HistogramSnapshot& latency_snapshot, const std::string& filename) const
 {
   std::ofstream outfile(filename);
   if (!outfile)
@@ -92,16 +130,16 @@ void Metrics::outputLatencyCDFToFile(const std::string& filename) const
   // Write header
   outfile << "percentile,latency_ns\n";
 
-  outfile << "Min," << acc::min(access_latency_) << "\n";
+  outfile << "Min," << (latency_snapshot.count > 0 ? latency_snapshot.min : 0) << "\n";
   // Write each percentile point
   for (size_t i = 0; i < std::size(probabilities); i++)
   {
     double percentile = probabilities[i];
-    uint64_t latency = acc::extended_p_square(access_latency_)[i];
+    uint64_t latency = latency_snapshot.percentile(percentile);
     outfile << percentile << "," << latency << "\n";
   }
-  outfile << "Max," << acc::max(access_latency_) << "\n";
-  outfile << "Mean," << acc::mean(access_latency_) << "\n";
+  outfile << "Max," << latency_snapshot.max << "\n";
+  outfile << "Mean," << latency_snapshot.mean() << "\n";
 
   outfile.close();
   LOG_INFO("CDF data written to: " << filename);
@@ -109,34 +147,80 @@ void Metrics::outputLatencyCDFToFile(const std::string& filename) const
 
 void Metrics::reset()
 {
-  local_access_count_ = 0;
-  remote_access_count_ = 0;
-  pmem_access_count_ = 0;
-  local_to_remote_count_ = 0;
-  remote_to_local_count_ = 0;
-  pmem_to_remote_count_ = 0;
-  remote_to_pmem_count_ = 0;
-  local_to_pmem_count_ = 0;
-  pmem_to_local_count_ = 0;
-  total_latency_ = 0;
-  access_latency_ = AccumulatorType{ acc::tag::extended_p_square::probabilities =
-                                        probabilities };
+  boost::lock_guard<boost::mutex> lock(shards_mutex_);
+  for (auto& shard : shards_)
+  {
+    for (auto& counter : shard->counters)
+    {
+      counter.store(0, std::memory_order_relaxed);
+    }
+    shard->access_latency.reset();
+    shard->end_to_end_latency.reset();
+  }
+  migration_queue_depth_ = 0;
+  migration_latency_max_ = 0;
+  last_period_latency_snapshot_ = HistogramSnapshot();
+  last_period_e2e_snapshot_ = HistogramSnapshot();
+}
+
+Metrics::CounterShard* Metrics::_registerShard()
+{
+  boost::lock_guard<boost::mutex> lock(shards_mutex_);
+  shards_.push_back(std::make_unique<CounterShard>());
+  return shards_.back().get();
+}
+
+Metrics::CounterSnapshot Metrics::_aggregateCounters() const
+{
+  CounterSnapshot totals{};
+  boost::lock_guard<boost::mutex> lock(shards_mutex_);
+  for (const auto& shard : shards_)
+  {
+    for (size_t i = 0; i < NUM_COUNTERS; i++)
+    {
+      totals[i] += shard->counters[i].load(std::memory_order_relaxed);
+    }
+  }
+  return totals;
+}
+
+HistogramSnapshot Metrics::_aggregateLatency(LatencyHistogram CounterShard::* histogram) const
+{
+  HistogramSnapshot total;
+  boost::lock_guard<boost::mutex> lock(shards_mutex_);
+  for (const auto& shard : shards_)
+  {
+    total.merge(((*shard).*histogram).snapshot());
+  }
+  return total;
 }
 
 void Metrics::periodicalMetrics(ServerMemoryConfig* server_config, int_least64_t interval, const std::string& periodic_metric_filename)
 {
+  // Aggregate the per-thread shards once so all values come from one pass
+  CounterSnapshot counters = _aggregateCounters();
+
   // Store current counter values to ensure consistency
-  uint64_t total_latency_now = total_latency_.load();
-  uint64_t local_access_count_now = local_access_count_.load();
-  uint64_t remote_access_count_now = remote_access_count_.load();
-  uint64_t pmem_access_count_now = pmem_access_count_.load();
-
-  uint64_t local_to_remote_count_now = local_to_remote_count_.load();
-  uint64_t remote_to_local_count_now = remote_to_local_count_.load();
-  uint64_t pmem_to_remote_count_now = pmem_to_remote_count_.load();
-  uint64_t remote_to_pmem_count_now = remote_to_pmem_count_.load();
-  uint64_t local_to_pmem_count_now = local_to_pmem_count_.load();
-  uint64_t pmem_to_local_count_now = pmem_to_local_count_.load();
+  uint64_t total_latency_now = counters[TOTAL_LATENCY];
+  HistogramSnapshot latency_snapshot_now = _aggregateLatency();
+  HistogramSnapshot current_latency_snapshot =
+    latency_snapshot_now.delta(last_period_latency_snapshot_);
+  HistogramSnapshot e2e_snapshot_now = _aggregateLatency(&CounterShard::end_to_end_latency);
+  HistogramSnapshot current_e2e_snapshot = e2e_snapshot_now.delta(last_period_e2e_snapshot_);
+  uint64_t local_access_count_now = counters[LOCAL_ACCESS];
+  uint64_t remote_access_count_now = counters[REMOTE_ACCESS];
+  uint64_t pmem_access_count_now = counters[PMEM_ACCESS];
+
+  uint64_t local_to_remote_count_now = counters[LOCAL_TO_REMOTE];
+  uint64_t remote_to_local_count_now = counters[REMOTE_TO_LOCAL];
+  uint64_t pmem_to_remote_count_now = counters[PMEM_TO_REMOTE];
+  uint64_t remote_to_pmem_count_now = counters[REMOTE_TO_PMEM];
+  uint64_t local_to_pmem_count_now = counters[LOCAL_TO_PMEM];
+  uint64_t pmem_to_local_count_now = counters[PMEM_TO_LOCAL];
+  uint64_t migration_syscall_count_now = counters[MIGRATION_SYSCALL];
+  uint64_t migration_failure_count_now = counters[MIGRATION_FAILURE];
+  uint64_t migration_latency_total_now = counters[MIGRATION_LATENCY_TOTAL];
+  uint64_t migration_latency_count_now = counters[MIGRATION_LATENCY_COUNT];
 
   // Calculate deltas since last period
   uint64_t current_latency = total_latency_now - last_period_latency_;
@@ -157,6 +241,16 @@ void Metrics::periodicalMetrics(ServerMemoryConfig* server_config, int_least64_t
   uint64_t current_remote_to_pmem_count = remote_to_pmem_count_now - last_period_remote_to_pmem_count_;
   uint64_t current_local_to_pmem_count = local_to_pmem_count_now - last_period_local_to_pmem_count_;
   uint64_t current_pmem_to_local_count = pmem_to_local_count_now - last_period_pmem_to_local_count_;
+  uint64_t current_migration_syscall_count = migration_syscall_count_now - last_period_migration_syscall_count_;
+  uint64_t current_migration_failure_count = migration_failure_count_now - last_period_migration_failure_count_;
+  uint64_t current_migration_latency_count = migration_latency_count_now - last_period_migration_latency_count_;
+  double avg_migration_latency_us = 0.0;
+  if (current_migration_latency_count > 0)
+  {
+    avg_migration_latency_us =
+      static_cast<double>(migration_latency_total_now - last_period_migration_latency_total_) /
+      1000.0 / static_cast<double>(current_migration_latency_count);
+  }
 
   // Calculate throughput
   double throughput = 0.0;
@@ -169,8 +263,19 @@ void Metrics::periodicalMetrics(ServerMemoryConfig* server_config, int_least64_t
       static_cast<double>(current_access);
   }
 
+  // Requests served per wall-clock second, includes queueing overhead
+  double served_throughput = 0.0;
+  if (interval > last_period_interval_)
+  {
+    served_throughput = static_cast<double>(current_access) /
+      static_cast<double>(interval - last_period_interval_);
+  }
+
   // Update last period values for next report
+  last_period_interval_ = interval;
   last_period_latency_ = total_latency_now;
+  last_period_latency_snapshot_ = std::move(latency_snapshot_now);
+  last_period_e2e_snapshot_ = std::move(e2e_snapshot_now);
   last_period_local_access_count_ = local_access_count_now;
   last_period_remote_access_count_ = remote_access_count_now;
   last_period_pmem_access_count_ = pmem_access_count_now;
@@ -181,6 +286,10 @@ void Metrics::periodicalMetrics(ServerMemoryConfig* server_config, int_least64_t
   last_period_remote_to_pmem_count_ = remote_to_pmem_count_now;
   last_period_local_to_pmem_count_ = local_to_pmem_count_now;
   last_period_pmem_to_local_count_ = pmem_to_local_count_now;
+  last_period_migration_syscall_count_ = migration_syscall_count_now;
+  last_period_migration_failure_count_ = migration_failure_count_now;
+  last_period_migration_latency_total_ = migration_latency_total_now;
+  last_period_migration_latency_count_ = migration_latency_count_now;
 
   // Output metrics to file
   std::ofstream out_file;
@@ -200,7 +309,10 @@ void Metrics::periodicalMetrics(ServerMemoryConfig* server_config, int_least64_t
     out_file << "Latency(ns),Throughput(ops/"
       "s),LocalAccess,RemoteAccess,PmemAccess,TotalAccess,"
       "local2remote,remote2local,remote2pmem,pmem2remote,local2pmem,pmem2local,"
-      "LocalCount,RemoteCount,PmemCount,Interval"
+      "LocalCount,RemoteCount,PmemCount,Interval,ServedThroughput(ops/s),"
+      "MigrationSyscalls,MigrationFailures,MigrationQueueDepth,MigrationLatency(us),"
+      "P50(ns),P99(ns),P999(ns),P9999(ns),"
+      "E2EP50(ns),E2EP99(ns),E2EP999(ns),E2EP9999(ns)"
       << std::endl;
   }
 
@@ -217,7 +329,19 @@ void Metrics::periodicalMetrics(ServerMemoryConfig* server_config, int_least64_t
     << server_config->local_numa.count << ","
     << server_config->remote_numa.count << ","
     << server_config->pmem.count << ","
-    << interval << std::endl;
+    << interval << "," << served_throughput << ","
+    << current_migration_syscall_count << ","
+    << current_migration_failure_count << ","
+    << migration_queue_depth_.load() << ","
+    << avg_migration_latency_us << ","
+    << current_latency_snapshot.percentile(0.5) << ","
+    << current_latency_snapshot.percentile(0.99) << ","
+    << current_latency_snapshot.percentile(0.999) << ","
+    << current_latency_snapshot.percentile(0.9999) << ","
+    << current_e2e_snapshot.percentile(0.5) << ","
+    << current_e2e_snapshot.percentile(0.99) << ","
+    << current_e2e_snapshot.percentile(0.999) << ","
+    << current_e2e_snapshot.percentile(0.9999) << std::endl;
 
   out_file.close();
 }
\ No newline at end of file
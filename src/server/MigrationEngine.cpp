@@ -0,0 +1,224 @@
+#include "MigrationEngine.hpp"
+
+MigrationEngine::MigrationEngine(PageTable* page_table, size_t num_workers,
+  size_t queue_capacity, size_t batch_size, size_t flush_interval_ms)
+  : page_table_(page_table), num_workers_(num_workers),
+  queue_capacity_(queue_capacity), batch_size_(batch_size),
+  flush_interval_(flush_interval_ms) {
+}
+
+MigrationEngine::~MigrationEngine() {
+  signalShutdown();
+  join();
+}
+
+void MigrationEngine::start() {
+  for (size_t i = 0; i < num_workers_; i++) {
+    workers_.emplace_back(&MigrationEngine::_runWorker, this, i);
+  }
+}
+
+void MigrationEngine::join() {
+  for (auto& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+bool MigrationEngine::submit(size_t page_id, PageLayer source_layer, PageLayer target_layer) {
+  return _submit({ page_id, source_layer, target_layer, boost::chrono::steady_clock::now() }, 1);
+}
+
+bool MigrationEngine::submitRegion(size_t region, PageLayer source_layer, PageLayer target_layer) {
+  return _submit({ region, source_layer, target_layer, boost::chrono::steady_clock::now(), true },
+    page_table_->regionSize(region));
+}
+
+bool MigrationEngine::_submit(MigrationJob job, size_t pages) {
+  boost::unique_lock<boost::mutex> lock(queue_mutex_);
+  PageLayer source_layer = job.source_layer;
+  PageLayer target_layer = job.target_layer;
+
+  // Coalesce with a job already queued or in flight for this page, a new
+  // target needs room of its own. An in-flight page cannot be redirected,
+  // the next round decides again from the layer it lands on.
+  auto it = pending_.find(_key(job));
+  if (it != pending_.end()) {
+    PendingJob& pending = it->second;
+    if (pending.target_layer == target_layer) {
+      return true;
+    }
+    if (pending.state == JobState::IN_FLIGHT) {
+      rejected_++;
+      return false;
+    }
+    if (!_admit(source_layer, target_layer, pages, &pending)) {
+      rejected_++;
+      return false;
+    }
+    pending.source_layer = source_layer;
+    pending.target_layer = target_layer;
+    return true;
+  }
+
+  // Backpressure: wait for workers to make room
+  not_full_.wait(lock, [this]() {
+    return queue_.size() < queue_capacity_ || shutdown_flag_;
+    });
+  if (shutdown_flag_) {
+    return false;
+  }
+  if (!_admit(source_layer, target_layer, pages)) {
+    rejected_++;
+    return false;
+  }
+
+  queue_.push_back(job);
+  pending_[_key(job)] = { JobState::QUEUED, source_layer, target_layer, pages };
+  Metrics::getInstance().setMigrationQueueDepth(queue_.size());
+
+  if (queue_.size() >= batch_size_) {
+    not_empty_.notify_one();
+  }
+  return true;
+}
+
+size_t MigrationEngine::takeRejected() {
+  boost::lock_guard<boost::mutex> lock(queue_mutex_);
+  size_t rejected = rejected_;
+  rejected_ = 0;
+  return rejected;
+}
+
+bool MigrationEngine::_admit(PageLayer source_layer, PageLayer target_layer, size_t pages,
+  const PendingJob* replaced) {
+  size_t source = static_cast<size_t>(source_layer);
+  size_t target = static_cast<size_t>(target_layer);
+  size_t room = page_table_->roomIn(target_layer);
+  // Counted without the share of the job being replaced, which is only
+  // released once the new target fits
+  size_t inbound = inbound_[target];
+  size_t outbound = outbound_[target];
+  if (replaced) {
+    inbound -= replaced->target_layer == target_layer ? replaced->pages : 0;
+    outbound -= replaced->source_layer == target_layer ? replaced->pages : 0;
+  }
+  if (room != std::numeric_limits<size_t>::max() && inbound + pages > room + outbound) {
+    return false;
+  }
+  if (replaced) {
+    _release(replaced->source_layer, replaced->target_layer, replaced->pages);
+  }
+  inbound_[target] += pages;
+  outbound_[source] += pages;
+  return true;
+}
+
+void MigrationEngine::_release(PageLayer source_layer, PageLayer target_layer, size_t pages) {
+  inbound_[static_cast<size_t>(target_layer)] -= pages;
+  outbound_[static_cast<size_t>(source_layer)] -= pages;
+}
+
+void MigrationEngine::flush() {
+  boost::lock_guard<boost::mutex> lock(queue_mutex_);
+  flush_requested_ = true;
+  not_empty_.notify_all();
+}
+
+void MigrationEngine::signalShutdown() {
+  boost::lock_guard<boost::mutex> lock(queue_mutex_);
+  shutdown_flag_ = true;
+  not_empty_.notify_all();
+  not_full_.notify_all();
+}
+
+size_t MigrationEngine::queueDepth() {
+  boost::lock_guard<boost::mutex> lock(queue_mutex_);
+  return queue_.size();
+}
+
+void MigrationEngine::_runWorker(size_t worker_id) {
+  LOG_INFO("Migration worker " << worker_id << " start!");
+  std::vector<MigrationJob> batch;
+  batch.reserve(batch_size_);
+
+  while (true) {
+    {
+      boost::unique_lock<boost::mutex> lock(queue_mutex_);
+      // Wait for a full batch, an explicit flush, or the flush interval
+      not_empty_.wait_for(lock, flush_interval_, [this]() {
+        return queue_.size() >= batch_size_ || flush_requested_ || shutdown_flag_;
+        });
+      if (shutdown_flag_) {
+        break;
+      }
+
+      while (!queue_.empty() && batch.size() < batch_size_) {
+        MigrationJob job = queue_.front();
+        queue_.pop_front();
+        // Latest decision for this page wins
+        PendingJob& pending = pending_[_key(job)];
+        job.source_layer = pending.source_layer;
+        job.target_layer = pending.target_layer;
+        pending.state = JobState::IN_FLIGHT;
+        batch.push_back(job);
+      }
+      if (queue_.empty()) {
+        flush_requested_ = false;
+      }
+      Metrics::getInstance().setMigrationQueueDepth(queue_.size());
+    }
+
+    if (batch.empty()) {
+      continue;
+    }
+    not_full_.notify_all();
+
+    _executeBatch(batch);
+
+    {
+      boost::lock_guard<boost::mutex> lock(queue_mutex_);
+      for (const MigrationJob& job : batch) {
+        auto it = pending_.find(_key(job));
+        _release(job.source_layer, job.target_layer, it->second.pages);
+        pending_.erase(it);
+      }
+      // Every admitted page is released exactly once
+      for (size_t layer = 0; pending_.empty() && layer < 3; layer++) {
+        assert(inbound_[layer] == 0 && outbound_[layer] == 0 && "Migration accounting leaked on drain");
+      }
+    }
+    batch.clear();
+  }
+  LOG_INFO("Migration worker " << worker_id << " exiting...");
+}
+
+void MigrationEngine::_executeBatch(std::vector<MigrationJob>& batch) {
+  // Group by target layer, demotions first so promotions find free space
+  std::vector<size_t> page_ids;
+  std::vector<size_t> regions;
+  page_ids.reserve(batch.size());
+  for (PageLayer target_layer : { PageLayer::PMEM, PageLayer::NUMA_REMOTE, PageLayer::NUMA_LOCAL }) {
+    page_ids.clear();
+    regions.clear();
+    for (const MigrationJob& job : batch) {
+      if (job.target_layer == target_layer) {
+        (job.region ? regions : page_ids).push_back(job.page_id);
+      }
+    }
+    if (!regions.empty()) {
+      page_table_->migrateRegions(regions, target_layer);
+    }
+    if (!page_ids.empty()) {
+      page_table_->migratePages(page_ids, target_layer);
+    }
+  }
+
+  auto now = boost::chrono::steady_clock::now();
+  auto& metrics = Metrics::getInstance();
+  for (const MigrationJob& job : batch) {
+    metrics.recordMigrationLatency(
+      boost::chrono::duration_cast<boost::chrono::nanoseconds>(now - job.enqueue_time).count());
+  }
+}
@@ -0,0 +1,246 @@
+#include "PageClassifier.hpp"
+
+#include <algorithm>
+#include <immintrin.h>
+#include <limits>
+
+namespace {
+
+inline uint32_t clampThreshold(size_t value)
+{
+  return static_cast<uint32_t>(std::min<size_t>(value, std::numeric_limits<uint32_t>::max()));
+}
+
+// One bit per 32-bit lane
+__attribute__((target("avx2")))
+inline uint64_t laneMask(__m256i lanes)
+{
+  return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(lanes)));
+}
+
+} // namespace
+
+PageClassifier::PageClassifier(const PolicyConfig& policy, size_t num_tiers, ClassifierIsa isa)
+  : isa_(isa), num_tiers_(num_tiers), hot_age_ms_(0), cold_age_ms_(0), hot_count_(0),
+  cold_count_(0), table_(_truthTable(policy))
+{
+  // Thresholds a policy does not use stay 0, its truth table ignores them.
+  // Clamping to 32 bits keeps every test's meaning: no age or count
+  // reaches UINT32_MAX.
+  if (policy.policy_type == "lru")
+  {
+    auto& lru = std::get<LRUPolicyConfig>(policy.config);
+    hot_age_ms_ = clampThreshold(lru.hot_threshold_ms);
+    cold_age_ms_ = clampThreshold(lru.cold_threshold_ms);
+  }
+  else if (policy.policy_type == "frequency")
+  {
+    auto& freq = std::get<FrequencyPolicyConfig>(policy.config);
+    hot_count_ = clampThreshold(freq.hot_access_count);
+    cold_count_ = clampThreshold(freq.cold_access_count);
+  }
+  else if (policy.policy_type == "hybrid")
+  {
+    auto& hybrid = std::get<HybridPolicyConfig>(policy.config);
+    hot_age_ms_ = clampThreshold(hybrid.hot_threshold_ms);
+    cold_age_ms_ = clampThreshold(hybrid.cold_threshold_ms);
+    hot_count_ = clampThreshold(hybrid.hot_access_count);
+    cold_count_ = clampThreshold(hybrid.cold_access_count);
+  }
+}
+
+uint8_t PageClassifier::_truthTable(const PolicyConfig& policy)
+{
+  uint8_t table = 0;
+  for (unsigned outcome = 0; outcome < 4; outcome++)
+  {
+    bool recency = outcome & 2;
+    bool frequency = outcome & 1;
+    bool classified = false;
+    if (policy.policy_type == "lru")
+    {
+      classified = recency;
+    }
+    else if (policy.policy_type == "frequency")
+    {
+      classified = frequency;
+    }
+    else if (policy.policy_type == "hybrid")
+    {
+      auto& hybrid = std::get<HybridPolicyConfig>(policy.config);
+      double score = (recency ? hybrid.weight_recency : 0.0) +
+        (frequency ? hybrid.weight_frequency : 0.0);
+      classified = score >= (hybrid.weight_recency + hybrid.weight_frequency) / 2;
+    }
+    table |= static_cast<uint8_t>(classified) << outcome;
+  }
+  return table;
+}
+
+uint64_t PageClassifier::_combine(uint8_t table, uint64_t recency, uint64_t frequency)
+{
+  uint64_t result = 0;
+  for (unsigned outcome = 0; outcome < 4; outcome++)
+  {
+    if (table & (1u << outcome))
+    {
+      result |= ((outcome & 2) ? recency : ~recency) & ((outcome & 1) ? frequency : ~frequency);
+    }
+  }
+  return result;
+}
+
+void PageClassifier::classify(const ClassifyBlock& block, uint64_t& hot, uint64_t& cold) const
+{
+  Predicates predicates;
+  _predicates(block, predicates);
+  uint64_t valid = block.size >= CLASSIFY_BLOCK_SIZE ? ~0ULL : (1ULL << block.size) - 1;
+  hot = _combine(table_, predicates.recent, predicates.frequent) & valid;
+  cold = _combine(table_, predicates.stale, predicates.infrequent) & valid & ~hot;
+}
+
+MigrationMasks PageClassifier::targets(const ClassifyBlock& block) const
+{
+  Predicates predicates;
+  _predicates(block, predicates);
+  uint64_t valid = block.size >= CLASSIFY_BLOCK_SIZE ? ~0ULL : (1ULL << block.size) - 1;
+  uint64_t hot = _combine(table_, predicates.recent, predicates.frequent) & valid;
+  uint64_t cold = _combine(table_, predicates.stale, predicates.infrequent) & valid & ~hot;
+  uint64_t warm = valid & ~hot & ~cold;
+  uint64_t local = predicates.local & valid;
+  uint64_t pmem = predicates.pmem & valid;
+  uint64_t remote = valid & ~local & ~pmem;
+
+  // Same moves as the per-page scan: cold pages step down one tier, hot
+  // pages go to NUMA_LOCAL, warm PMEM pages step up one tier
+  MigrationMasks masks;
+  if (num_tiers_ == 2)
+  {
+    masks.to_local = pmem & (hot | warm);
+    masks.to_remote = 0;
+    masks.to_pmem = local & cold;
+  }
+  else
+  {
+    masks.to_local = (remote | pmem) & hot;
+    masks.to_remote = (local & cold) | (pmem & warm);
+    masks.to_pmem = remote & cold;
+  }
+  return masks;
+}
+
+void PageClassifier::_predicates(const ClassifyBlock& block, Predicates& result) const
+{
+  switch (isa_)
+  {
+  case ClassifierIsa::AVX512:
+    _predicatesAvx512(block, result);
+    break;
+  case ClassifierIsa::AVX2:
+    _predicatesAvx2(block, result);
+    break;
+  default:
+    _predicatesScalar(block, result);
+    break;
+  }
+}
+
+void PageClassifier::_predicatesScalar(const ClassifyBlock& block, Predicates& result) const
+{
+  result = Predicates{};
+  for (size_t i = 0; i < CLASSIFY_BLOCK_SIZE; i++)
+  {
+    uint64_t bit = 1ULL << i;
+    result.recent |= block.age_ms[i] <= hot_age_ms_ ? bit : 0;
+    result.frequent |= block.count[i] >= hot_count_ ? bit : 0;
+    result.stale |= block.age_ms[i] >= cold_age_ms_ ? bit : 0;
+    result.infrequent |= block.count[i] <= cold_count_ ? bit : 0;
+    result.local |= block.layer[i] == static_cast<uint8_t>(PageLayer::NUMA_LOCAL) ? bit : 0;
+    result.pmem |= block.layer[i] == static_cast<uint8_t>(PageLayer::PMEM) ? bit : 0;
+  }
+}
+
+__attribute__((target("avx2")))
+void PageClassifier::_predicatesAvx2(const ClassifyBlock& block, Predicates& result) const
+{
+  result = Predicates{};
+  const __m256i hot_age = _mm256_set1_epi32(static_cast<int>(hot_age_ms_));
+  const __m256i cold_age = _mm256_set1_epi32(static_cast<int>(cold_age_ms_));
+  const __m256i hot_count = _mm256_set1_epi32(static_cast<int>(hot_count_));
+  const __m256i cold_count = _mm256_set1_epi32(static_cast<int>(cold_count_));
+
+  // No unsigned compare in AVX2: a <= b exactly when min(a, b) == a
+  for (size_t i = 0; i < CLASSIFY_BLOCK_SIZE; i += 8)
+  {
+    __m256i age = _mm256_load_si256(reinterpret_cast<const __m256i*>(block.age_ms + i));
+    __m256i count = _mm256_load_si256(reinterpret_cast<const __m256i*>(block.count + i));
+    result.recent |= laneMask(_mm256_cmpeq_epi32(_mm256_min_epu32(age, hot_age), age)) << i;
+    result.frequent |= laneMask(_mm256_cmpeq_epi32(_mm256_max_epu32(count, hot_count), count)) << i;
+    result.stale |= laneMask(_mm256_cmpeq_epi32(_mm256_max_epu32(age, cold_age), age)) << i;
+    result.infrequent |= laneMask(_mm256_cmpeq_epi32(_mm256_min_epu32(count, cold_count), count)) << i;
+  }
+
+  const __m256i local = _mm256_set1_epi8(static_cast<char>(PageLayer::NUMA_LOCAL));
+  const __m256i pmem = _mm256_set1_epi8(static_cast<char>(PageLayer::PMEM));
+  for (size_t i = 0; i < CLASSIFY_BLOCK_SIZE; i += 32)
+  {
+    __m256i layers = _mm256_load_si256(reinterpret_cast<const __m256i*>(block.layer + i));
+    result.local |= static_cast<uint64_t>(static_cast<uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(layers, local)))) << i;
+    result.pmem |= static_cast<uint64_t>(static_cast<uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(layers, pmem)))) << i;
+  }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void PageClassifier::_predicatesAvx512(const ClassifyBlock& block, Predicates& result) const
+{
+  result = Predicates{};
+  const __m512i hot_age = _mm512_set1_epi32(static_cast<int>(hot_age_ms_));
+  const __m512i cold_age = _mm512_set1_epi32(static_cast<int>(cold_age_ms_));
+  const __m512i hot_count = _mm512_set1_epi32(static_cast<int>(hot_count_));
+  const __m512i cold_count = _mm512_set1_epi32(static_cast<int>(cold_count_));
+
+  for (size_t i = 0; i < CLASSIFY_BLOCK_SIZE; i += 16)
+  {
+    __m512i age = _mm512_load_si512(block.age_ms + i);
+    __m512i count = _mm512_load_si512(block.count + i);
+    result.recent |= static_cast<uint64_t>(_mm512_cmple_epu32_mask(age, hot_age)) << i;
+    result.frequent |= static_cast<uint64_t>(_mm512_cmpge_epu32_mask(count, hot_count)) << i;
+    result.stale |= static_cast<uint64_t>(_mm512_cmpge_epu32_mask(age, cold_age)) << i;
+    result.infrequent |= static_cast<uint64_t>(_mm512_cmple_epu32_mask(count, cold_count)) << i;
+  }
+
+  __m512i layers = _mm512_load_si512(block.layer);
+  result.local = _mm512_cmpeq_epi8_mask(layers,
+    _mm512_set1_epi8(static_cast<char>(PageLayer::NUMA_LOCAL)));
+  result.pmem = _mm512_cmpeq_epi8_mask(layers,
+    _mm512_set1_epi8(static_cast<char>(PageLayer::PMEM)));
+}
+
+ClassifierIsa PageClassifier::bestIsa()
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+  {
+    return ClassifierIsa::AVX512;
+  }
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return ClassifierIsa::AVX2;
+  }
+  return ClassifierIsa::SCALAR;
+}
+
+const char* PageClassifier::isaName(ClassifierIsa isa)
+{
+  switch (isa)
+  {
+  case ClassifierIsa::AVX512:
+    return "avx512";
+  case ClassifierIsa::AVX2:
+    return "avx2";
+  default:
+    return "scalar";
+  }
+}
@@ -3,7 +3,7 @@
 PageTable::PageTable(const std::vector<ClientConfig>& client_configs,
   ServerMemoryConfig* server_config, bool enable_cache_ring)
   : client_configs_(client_configs), server_config_(server_config),
-  enable_cache_ring_(enable_cache_ring)
+  backend_(createTierBackend(*server_config)), enable_cache_ring_(enable_cache_ring)
 {
   if (server_config_->num_tiers == 2)
   {
@@ -23,39 +23,57 @@ PageTable::PageTable(const std::vector<ClientConfig>& client_configs,
     }
   }
 
+  // Each ring holds every page its layer can, it never grows
   if (enable_cache_ring_) {
-    local_cache_ring_ = std::make_unique<ClockRing>(local_page_load_);
+    size_t loads[] = { local_page_load_, remote_page_load_, pmem_page_load_ };
+    for (PageLayer layer : { PageLayer::NUMA_LOCAL, PageLayer::NUMA_REMOTE, PageLayer::PMEM }) {
+      size_t tier = static_cast<size_t>(layer);
+      tier_rings_[tier] = std::make_unique<ClockRing>(
+        std::max(_getLayerInfo(layer)->capacity, loads[tier]), server_config_->clock_max_count);
+    }
+  }
+
+  size_t total_pages = local_page_load_ + remote_page_load_ + pmem_page_load_;
+  page_address_ = std::vector<std::atomic<void*>>(total_pages);
+  // Region mode keeps hotness per region only
+  region_mode_ = server_config_->migration_unit == MigrationUnit::REGION;
+  metadata_ = PageMetadataArray(total_pages, !region_mode_);
+
+  if (server_config_->hotness_source == HotnessSource::IDLE_BITMAP)
+  {
+    idle_tracker_ = std::make_unique<IdlePageTracker>();
+    if (!idle_tracker_->available())
+    {
+      LOG_WARN("Falling back to software hotness counters");
+      idle_tracker_.reset();
+    }
   }
 }
 
 PageTable::~PageTable()
 {
-  table_.clear();
-  if (local_base_)
-  {
-    munmap(local_base_, local_page_load_ * PAGE_SIZE);
-  }
-  if (remote_base_)
-  {
-    munmap(remote_base_, remote_page_load_ * PAGE_SIZE);
-  }
-  if (pmem_base_)
-  {
-    munmap(pmem_base_, pmem_page_load_ * PAGE_SIZE);
-  }
+  // The backend unmaps the tiers
 }
 
 void PageTable::initPageTable()
 {
   // Fill in order: first all allocations for client 1 (local, remote, pmem),
   // then client 2, etc.
+  auto start = boost::chrono::steady_clock::now();
   _allocateMemory();
-  _generateRandomContent();
+  double allocate_ms = _elapsedMs(start);
+
+  start = boost::chrono::steady_clock::now();
+  _generateContent();
+  double content_ms = _elapsedMs(start);
+
+  start = boost::chrono::steady_clock::now();
 
   size_t current_index = 0;
   size_t local_offset_pages = 0;
   size_t remote_offset_pages = 0;
   size_t pmem_offset_pages = 0;
+  uint64_t now_ms = PageMetadataArray::nowMs();
 
   auto fillPages = [&](PageLayer layer, size_t count, void* base,
     size_t& offset)
@@ -64,17 +82,28 @@ void PageTable::initPageTable()
       {
         char* addr = static_cast<char*>(base) + offset * PAGE_SIZE;
 
-        table_.emplace(std::piecewise_construct,
-          std::forward_as_tuple(current_index),
-          std::forward_as_tuple(static_cast<void*>(addr), layer));
+        page_address_[current_index].store(addr, std::memory_order_relaxed);
+        metadata_.setLayer(current_index, layer);
+        if (region_mode_)
+        {
+          // Tiers start on a huge page boundary, a region starts with each
+          // segment and each huge page of the tier
+          if (i == 0 || offset % REGION_PAGES == 0)
+          {
+            region_start_.push_back(current_index);
+          }
+        }
+        else
+        {
+          metadata_.setLastAccessTimeMs(current_index, now_ms);
+        }
 
-        // If ring is enabled and this is a NUMA_LOCAL page, insert into the ring
-        if (enable_cache_ring_ && layer == PageLayer::NUMA_LOCAL)
+        if (enable_cache_ring_)
         {
-          auto& page_meta = table_[current_index].metadata;
-          ClockRingNode* node = nullptr;
-          assert(local_cache_ring_->insert(current_index, node) && "Insert into cache ring fail");
-          page_meta.ring_node_ptr.store(node, std::memory_order_relaxed);
+          bool inserted = _ring(layer)->insert(current_index,
+            metadata_.ringHandleSlot(current_index));
+          assert(inserted && "Insert into cache ring fail");
+          (void)inserted;
         }
 
         current_index++;
@@ -108,62 +137,222 @@ void PageTable::initPageTable()
     }
   }
 
-  LOG_INFO("Page Table Initialization Done.");
+  if (region_mode_)
+  {
+    _initRegions();
+  }
+
+  double metadata_ms = _elapsedMs(start);
+
+  // Arm the idle bits so the first round only sees accesses after startup
+  sampleAccessBits();
+
+  if (server_config_->huge_page_policy == HugePagePolicy::HOT)
+  {
+    huge_page_advisor_ = std::make_unique<HugePageAdvisor>(server_config_->huge_page_density);
+    const std::pair<PageLayer, void*> tiers[] = { { PageLayer::NUMA_LOCAL, local_base_ },
+      { PageLayer::NUMA_REMOTE, remote_base_ }, { PageLayer::PMEM, pmem_base_ } };
+    for (const auto& tier : tiers)
+    {
+      if (tier.second)
+      {
+        huge_page_advisor_->addTier(tier.first, tier.second, backend_->tierBytes(tier.first));
+      }
+    }
+    if (!region_mode_)
+    {
+      page_touched_ = std::vector<std::atomic<uint64_t>>((metadata_.size() + 63) / 64);
+    }
+  }
+
+  size_t metadata_bytes = metadata_.size() *
+    (PageMetadataArray::bytesPerPage(!region_mode_) + sizeof(void*));
+  if (region_mode_)
+  {
+    metadata_bytes += metadata_.size() / 4 + numRegions() * (PageMetadataArray::bytesPerPage() +
+      sizeof(size_t) + sizeof(region_layer_pages_[0]));
+  }
+  metadata_bytes += page_touched_.size() * sizeof(uint64_t);
+  LOG_INFO("Page Table Initialization Done. Metadata: " << metadata_bytes / 1024 << " KB for "
+    << metadata_.size() << " pages" << (region_mode_ ? " in " + std::to_string(numRegions())
+      + " regions" : std::string()));
+  LOG_INFO("Startup phases: allocation " << allocate_ms << " ms, content " << content_ms
+    << " ms, metadata " << metadata_ms << " ms");
+}
+
+void PageTable::setAccessHalfLife(size_t half_life_ms)
+{
+  half_life_ms_ = half_life_ms;
+  metadata_.setHalfLifeMs(half_life_ms);
+  region_metadata_.setHalfLifeMs(half_life_ms);
 }
 
 std::tuple<PageLayer, uint64_t, uint32_t> PageTable::getPageMetaData(size_t page_id)
 {
-  auto it = table_.find(page_id);
-  if (it == table_.end())
+  if (page_id >= metadata_.size())
   {
     LOG_ERROR("Get Page metadata index " << page_id << " not found");
     return std::make_tuple(PageLayer::NUMA_LOCAL, 0, 0);
   }
   // This has an possible race condition:
   // After scanning the metadata, this page is accessed. This might caused
-  // False cold page. For efficiency, we removed the lock here
+  // False cold page. For efficiency, we removed the lock here.
+  // The scan ages the access count in place, decayed counts stay current
+  // even for pages nobody touches.
+  PageMetadataArray& hotness = region_mode_ ? region_metadata_ : metadata_;
+  size_t index = region_mode_ ? _regionOf(page_id) : page_id;
   return std::make_tuple(
-    it->second.metadata.page_layer.load(),
-    it->second.metadata.last_access_time_ms.load(),
-    it->second.metadata.access_cnt.load());
+    metadata_.layer(page_id),
+    hotness.lastAccessTimeMs(index),
+    hotness.ageAccessCount(index, PageMetadataArray::nowMs()));
+}
+
+void PageTable::readBlock(size_t first_page, size_t count, uint64_t now_ms,
+  ClassifyBlock& block)
+{
+  block.size = std::min<size_t>(count, CLASSIFY_BLOCK_SIZE);
+  for (size_t i = 0; i < block.size; i++)
+  {
+    size_t page_id = first_page + i;
+    uint64_t last_access_ms = metadata_.lastAccessTimeMs(page_id);
+    block.age_ms[i] = static_cast<uint32_t>(std::min<uint64_t>(
+      now_ms > last_access_ms ? now_ms - last_access_ms : 0, UINT32_MAX));
+    block.count[i] = metadata_.ageAccessCount(page_id, now_ms);
+    block.layer[i] = static_cast<uint8_t>(metadata_.layer(page_id));
+  }
+}
+
+void PageTable::readRegionBlock(size_t first_region, size_t count, uint64_t now_ms,
+  ClassifyBlock& block, RegionTouchBlock& touched)
+{
+  block.size = std::min<size_t>(count, CLASSIFY_BLOCK_SIZE);
+  for (size_t i = 0; i < block.size; i++)
+  {
+    size_t region = first_region + i;
+    uint64_t last_access_ms = region_metadata_.lastAccessTimeMs(region);
+    block.age_ms[i] = static_cast<uint32_t>(std::min<uint64_t>(
+      now_ms > last_access_ms ? now_ms - last_access_ms : 0, UINT32_MAX));
+    block.count[i] = region_metadata_.ageAccessCount(region, now_ms);
+    block.layer[i] = static_cast<uint8_t>(region_metadata_.layer(region));
+
+    touched.count[i] = 0;
+    for (size_t w = 0; w < REGION_WORDS; w++)
+    {
+      std::atomic<uint64_t>& word = region_touched_[region * REGION_WORDS + w];
+      touched.bits[i][w] = word.load(std::memory_order_relaxed)
+        ? word.exchange(0, std::memory_order_relaxed) : 0;
+      touched.count[i] += __builtin_popcountll(touched.bits[i][w]);
+      region_round_touched_[region * REGION_WORDS + w] = touched.bits[i][w];
+    }
+  }
+}
+
+void PageTable::selectRegionPages(size_t region, PageLayer target_layer, const uint64_t* touched,
+  bool want_touched, std::vector<size_t>& pages)
+{
+  // PageLayer order is fastest first
+  bool promotion = target_layer < region_metadata_.layer(region);
+  size_t first_page = region_start_[region];
+  for (size_t j = 0; j < regionSize(region); j++)
+  {
+    if (touched && static_cast<bool>((touched[j / 64] >> (j % 64)) & 1) != want_touched)
+    {
+      continue;
+    }
+    PageLayer layer = metadata_.layer(first_page + j);
+    if (promotion ? layer > target_layer : layer < target_layer)
+    {
+      pages.push_back(first_page + j);
+    }
+  }
 }
 
-size_t PageTable::scanNext()
+size_t PageTable::roomIn(PageLayer layer)
 {
-  size_t current = scan_index_;
-  scan_index_++;
-  if (scan_index_ >= table_.size())
+  PageLayer lower;
+  if (enable_cache_ring_ && _lowerLayer(layer, lower))
   {
-    scan_index_ = 0;
+    return std::numeric_limits<size_t>::max();
   }
-  return current;
+  boost::lock_guard<boost::mutex> lock(migration_mutex_);
+  return _freeSlots(*_getLayerInfo(layer));
+}
+
+void PageTable::sampleAccessBits()
+{
+  if (!idle_tracker_)
+  {
+    return;
+  }
+
+  auto start = boost::chrono::steady_clock::now();
+  sample_addresses_.resize(page_address_.size());
+  for (size_t i = 0; i < page_address_.size(); i++)
+  {
+    sample_addresses_[i] = page_address_[i].load(std::memory_order_relaxed);
+  }
+  idle_tracker_->sample(sample_addresses_, sample_accessed_);
+
+  // A referenced page counts as accessed now, frequency is the number of
+  // sampling rounds the page was referenced in
+  uint64_t now_ms = PageMetadataArray::nowMs();
+  size_t referenced = 0;
+  for (size_t i = 0; i < sample_accessed_.size(); i++)
+  {
+    if (!sample_accessed_[i])
+    {
+      continue;
+    }
+    if (region_mode_)
+    {
+      _touchRegion(i, now_ms);
+    }
+    else
+    {
+      metadata_.setLastAccessTimeMs(i, now_ms);
+      metadata_.incrementAccessCount(i, now_ms);
+      _touchPage(i);
+    }
+    referenced++;
+  }
+  LOG_INFO("Sampled accessed bits: " << referenced << " of " << sample_accessed_.size()
+    << " pages referenced, " << _elapsedMs(start) << " ms");
 }
 
 void PageTable::accessPage(size_t page_id, OperationType mode)
 {
-  auto it = table_.find(page_id);
-  if (it == table_.end())
+  if (page_id >= metadata_.size())
   {
     LOG_ERROR("Update Page access index " << page_id << " not found");
     return;
   }
 
-  uint64_t access_time = access_page(it->second.page_address, mode);
-  PageMetadata& page_meta_data = it->second.metadata;
+  PageLayer page_layer = metadata_.layer(page_id);
+  uint64_t access_time = backend_->accessPage(
+    page_address_[page_id].load(std::memory_order_relaxed), page_layer, mode);
 
-  if (enable_cache_ring_ && page_meta_data.page_layer == PageLayer::NUMA_LOCAL) {
-    ClockRing::markAccessed(page_meta_data.ring_node_ptr.load(std::memory_order_relaxed));
+  if (enable_cache_ring_) {
+    // A page moving between layers may count once in its old ring
+    _ring(page_layer)->markAccessed(metadata_.ringHandle(page_id));
   }
 
-  auto now = boost::chrono::steady_clock::now();
-  auto duration = now.time_since_epoch();
-  auto ms = boost::chrono::duration_cast<boost::chrono::milliseconds>(duration)
-    .count();
-  page_meta_data.last_access_time_ms.store(ms, std::memory_order_relaxed);
-  page_meta_data.access_cnt++;
+  if (!idle_tracker_)
+  {
+    uint64_t now_ms = PageMetadataArray::nowMs();
+    if (region_mode_)
+    {
+      _touchRegion(page_id, now_ms);
+    }
+    else
+    {
+      metadata_.setLastAccessTimeMs(page_id, now_ms);
+      metadata_.incrementAccessCount(page_id, now_ms);
+      _touchPage(page_id);
+    }
+  }
 
   Metrics::getInstance().recordAccessLatency(access_time);
-  switch (page_meta_data.page_layer)
+  switch (page_layer)
   {
   case PageLayer::NUMA_LOCAL:
     Metrics::getInstance().incrementLocalAccess();
@@ -180,97 +369,224 @@ void PageTable::accessPage(size_t page_id, OperationType mode)
 
 void PageTable::migratePage(size_t page_index, PageLayer page_target_layer)
 {
-  auto it = table_.find(page_index);
-  if (it == table_.end())
+  migratePages(std::vector<size_t>{ page_index }, page_target_layer);
+}
+
+void PageTable::migratePages(const std::vector<size_t>& page_ids, PageLayer page_target_layer)
+{
+  _migrate(page_ids, std::vector<size_t>(), page_target_layer);
+}
+
+void PageTable::migrateRegions(const std::vector<size_t>& regions, PageLayer page_target_layer)
+{
+  std::vector<size_t> page_ids;
+  std::vector<size_t> group_ends;
+  for (size_t region : regions)
   {
-    LOG_ERROR("Update Page layer index " << page_index << " not found");
-    return;
+    if (region >= numRegions())
+    {
+      LOG_ERROR("Migrate region index " << region << " not found");
+      continue;
+    }
+    size_t group_start = page_ids.size();
+    selectRegionPages(region, page_target_layer, nullptr, false, page_ids);
+    if (page_ids.size() > group_start)
+    {
+      group_ends.push_back(page_ids.size());
+    }
   }
+  if (!page_ids.empty())
+  {
+    _migrate(page_ids, group_ends, page_target_layer);
+  }
+}
 
-  PageMetadata& page_meta_data = it->second.metadata;
-  PageLayer page_current_layer = page_meta_data.page_layer;
-
-  // Get target layer info
-  LayerInfo* target_layer_info = nullptr;
-  LayerInfo* current_layer_info = nullptr;
+void PageTable::_migrate(const std::vector<size_t>& page_ids,
+  const std::vector<size_t>& group_ends, PageLayer page_target_layer)
+{
+  LayerInfo* target_layer_info = _getLayerInfo(page_target_layer);
+  std::vector<size_t> candidates;
+  candidates.reserve(page_ids.size());
+  // Group ends translated to candidates
+  std::vector<size_t> candidate_ends;
+  std::vector<size_t> victims;
+  size_t shortage = 0;
 
-  // Get layer info pointers
-  switch (page_target_layer)
   {
-  case PageLayer::NUMA_LOCAL:
-    target_layer_info = &server_config_->local_numa;
-    break;
-  case PageLayer::NUMA_REMOTE:
-    target_layer_info = &server_config_->remote_numa;
-    break;
-  case PageLayer::PMEM:
-    target_layer_info = &server_config_->pmem;
-    break;
+    boost::lock_guard<boost::mutex> lock(migration_mutex_);
+
+    // Drop unknown pages, pages already on the target layer and pages
+    // another worker is moving
+    size_t group = 0;
+    for (size_t i = 0; i < page_ids.size(); i++)
+    {
+      size_t page_index = page_ids[i];
+      if (page_index >= metadata_.size())
+      {
+        LOG_ERROR("Update Page layer index " << page_index << " not found");
+      }
+      else if (metadata_.layer(page_index) != page_target_layer &&
+        migrating_.insert(page_index).second)
+      {
+        candidates.push_back(page_index);
+      }
+      if (group < group_ends.size() && i + 1 == group_ends[group])
+      {
+        if (candidates.size() > (candidate_ends.empty() ? 0 : candidate_ends.back()))
+        {
+          candidate_ends.push_back(candidates.size());
+        }
+        group++;
+      }
+    }
+    if (candidates.empty())
+    {
+      return;
+    }
+
+    PageLayer lower;
+    if (enable_cache_ring_ && _lowerLayer(page_target_layer, lower))
+    {
+      size_t free_slots = _freeSlots(*target_layer_info);
+      shortage = candidates.size() > free_slots ? candidates.size() - free_slots : 0;
+    }
   }
-  switch (page_current_layer)
+
+  // Pick ring victims to make room in the target layer. The ring is safe
+  // to sweep without the lock, other workers may be evicting at once.
+  for (size_t i = 0; i < shortage; i++)
   {
-  case PageLayer::NUMA_LOCAL:
-    current_layer_info = &server_config_->local_numa;
-    if (enable_cache_ring_) {
-      ClockRingNode* node = page_meta_data.ring_node_ptr.exchange(nullptr);
-      local_cache_ring_->remove(node);
+    size_t evict_id;
+    ClockRing::Handle handle;
+    if (!_ring(page_target_layer)->findEvictionCandidate(evict_id, handle))
+    {
+      break;
     }
-    break;
-  case PageLayer::NUMA_REMOTE:
-    current_layer_info = &server_config_->remote_numa;
-    break;
-  case PageLayer::PMEM:
-    current_layer_info = &server_config_->pmem;
-    break;
+    // The ring already freed the slot
+    metadata_.clearRingHandle(evict_id, handle);
+    victims.push_back(evict_id);
+  }
+
+  if (!victims.empty())
+  {
+    _demotePages(page_target_layer, victims);
   }
 
-  // Check capacity
-  if (page_target_layer == PageLayer::NUMA_LOCAL && enable_cache_ring_)
   {
-    if (target_layer_info->isFull()) {
-      // Evict a page from NUMA_LOCAL to NUMA_REMOTE
-      size_t evict_id = local_cache_ring_->findEvictionCandidate();
-      // We have possible that NUMA_REMMOTE is full
-      if (server_config_->remote_numa.isFull()) {
-        migratePage(evict_id, PageLayer::PMEM);
+    boost::lock_guard<boost::mutex> lock(migration_mutex_);
+
+    // Check capacity, then reserve target slots for the pages in flight.
+    // A group moves whole or not at all.
+    size_t free_slots = _freeSlots(*target_layer_info);
+    if (candidates.size() > free_slots)
+    {
+      size_t fits = free_slots;
+      if (!candidate_ends.empty())
+      {
+        fits = 0;
+        for (size_t end : candidate_ends)
+        {
+          if (end > free_slots)
+          {
+            break;
+          }
+          fits = end;
+        }
       }
-      else {
-        migratePage(evict_id, PageLayer::NUMA_REMOTE);
+      LOG_DEBUG(target_layer_info->count << " " << target_layer_info->capacity);
+      LOG_DEBUG(page_target_layer << " is full, " << candidates.size() - fits
+        << " page migrations failed");
+      for (size_t i = fits; i < candidates.size(); i++)
+      {
+        migrating_.erase(candidates[i]);
       }
+      candidates.resize(fits);
     }
+    target_layer_info->count += candidates.size();
   }
-  else if (target_layer_info->isFull())
+  if (candidates.empty())
   {
-    LOG_DEBUG(target_layer_info->count << " " << target_layer_info->capacity);
-    LOG_DEBUG(page_target_layer << " is full, page mitigate is failed");
     return;
   }
 
-  // Perform the page migration
-  LOG_DEBUG("Moving Page " << page_index << " from Node " << page_current_layer
-    << " to Node " << page_target_layer << "...");
-  migrate_page(it->second.page_address, page_current_layer, page_target_layer);
+  // Perform the page migration, one backend call for the whole batch.
+  // The copy runs outside the lock so other workers can proceed.
+  LOG_DEBUG("Moving " << candidates.size() << " pages to Node " << page_target_layer << "...");
+  std::vector<void*> addresses(candidates.size());
+  std::unique_ptr<bool[]> moved(new bool[candidates.size()]);
+  for (size_t i = 0; i < candidates.size(); i++)
+  {
+    addresses[i] = page_address_[candidates[i]].load(std::memory_order_relaxed);
+  }
+  backend_->migratePages(addresses.data(), addresses.size(), page_target_layer, moved.get());
+
+  auto& metrics = Metrics::getInstance();
+  metrics.incrementMigrationSyscall();
+
+  // Feed per-page results back into the metadata
+  uint64_t now_ms = PageMetadataArray::nowMs();
+  boost::lock_guard<boost::mutex> lock(migration_mutex_);
+  for (size_t i = 0; i < candidates.size(); i++)
+  {
+    migrating_.erase(candidates[i]);
+    if (!moved[i])
+    {
+      LOG_DEBUG("Page " << candidates[i] << " failed to move to " << page_target_layer);
+      metrics.incrementMigrationFailure();
+      target_layer_info->count--;
+      continue;
+    }
+    page_address_[candidates[i]].store(addresses[i], std::memory_order_relaxed);
+    _commitMigration(candidates[i], page_target_layer, now_ms);
+  }
+}
+
+void PageTable::_commitMigration(size_t page_index, PageLayer page_target_layer, uint64_t now_ms)
+{
+  PageLayer page_current_layer = metadata_.layer(page_index);
+  LayerInfo* current_layer_info = _getLayerInfo(page_current_layer);
+
   // Maintain metadata
-  page_meta_data.page_layer = page_target_layer;
+  if (enable_cache_ring_)
+  {
+    // Eviction victims have already left the ring, a page a concurrent
+    // sweep just took fails the remove
+    ClockRing::Handle handle = metadata_.exchangeRingHandle(page_index, ClockRing::NO_HANDLE);
+    if (handle != ClockRing::NO_HANDLE)
+    {
+      _ring(page_current_layer)->remove(handle);
+    }
+  }
+  metadata_.setLayer(page_index, page_target_layer);
 
-  if (enable_cache_ring_ && page_target_layer == PageLayer::NUMA_LOCAL) {
-    ClockRingNode* node = nullptr;
-    assert(local_cache_ring_->insert(page_index, node));
-    page_meta_data.ring_node_ptr.store(node, std::memory_order_relaxed);
+  if (enable_cache_ring_) {
+    bool inserted = _ring(page_target_layer)->insert(page_index,
+      metadata_.ringHandleSlot(page_index));
+    assert(inserted);
+    (void)inserted;
   }
 
-  auto now = boost::chrono::steady_clock::now();
-  auto duration = now.time_since_epoch();
-  auto ms = boost::chrono::duration_cast<boost::chrono::milliseconds>(duration)
-    .count();
-  page_meta_data.last_access_time_ms.store(ms, std::memory_order_relaxed);
-  page_meta_data.access_cnt.store(0, std::memory_order_relaxed);
+  // A region keeps its hotness, only some of its pages may have moved
+  if (region_mode_)
+  {
+    _moveRegionPage(page_index, page_current_layer, page_target_layer);
+  }
+  else
+  {
+    metadata_.setLastAccessTimeMs(page_index, now_ms);
+    metadata_.resetAccessCount(page_index);
+  }
   LOG_DEBUG("Page " << page_index << " now on Layer " << page_target_layer);
 
-  // Update counters, for now scanner run in single thread, we do not need
-  // Protect layer info count.
+  // Update counters, the target slot was reserved before the move and
+  // migration_mutex_ protects layer info count.
+  if (page_current_layer == page_target_layer)
+  {
+    // Another worker moved it here first, give the reserved slot back
+    current_layer_info->count--;
+    return;
+  }
   current_layer_info->count--;
-  target_layer_info->count++;
 
   // Update metrics
   auto& metrics = Metrics::getInstance();
@@ -297,120 +613,333 @@ void PageTable::migratePage(size_t page_index, PageLayer page_target_layer)
   }
 }
 
-void PageTable::promoteToHugePage()
+void PageTable::_demotePages(PageLayer layer, const std::vector<size_t>& victims)
 {
-  LOG_DEBUG("Promoting pages to huge pages...");
+  // The lower layer makes room the same way if it is full itself, so a
+  // full NUMA_LOCAL can push NUMA_REMOTE's victims on to PMEM
+  PageLayer lower;
+  if (_lowerLayer(layer, lower))
+  {
+    migratePages(victims, lower);
+  }
 
-  // Function to promote a memory region to huge pages
-  auto promoteRegion = [&](void* base, size_t num_pages, const char* region_name)
+  // Victims that failed to move stay and rejoin the ring
+  boost::lock_guard<boost::mutex> lock(migration_mutex_);
+  for (size_t evict_id : victims)
+  {
+    if (metadata_.layer(evict_id) == layer &&
+      metadata_.ringHandle(evict_id) == ClockRing::NO_HANDLE)
     {
-      if (!base || num_pages == 0)
-      {
-        LOG_DEBUG("No pages to promote for " << region_name);
-        return;
-      }
+      _ring(layer)->insert(evict_id, metadata_.ringHandleSlot(evict_id));
+    }
+  }
+}
+
+bool PageTable::_lowerLayer(PageLayer layer, PageLayer& lower) const
+{
+  switch (layer)
+  {
+  case PageLayer::NUMA_LOCAL:
+    lower = server_config_->num_tiers == 3 ? PageLayer::NUMA_REMOTE : PageLayer::PMEM;
+    return true;
+  case PageLayer::NUMA_REMOTE:
+    lower = PageLayer::PMEM;
+    return true;
+  default:
+    return false;
+  }
+}
+
+void PageTable::_initRegions()
+{
+  size_t total_pages = metadata_.size();
+  region_start_.push_back(total_pages);
+  size_t regions = numRegions();
+  region_metadata_ = PageMetadataArray(regions);
+  region_metadata_.setHalfLifeMs(half_life_ms_);
+  region_touched_ = std::vector<std::atomic<uint64_t>>(regions * REGION_WORDS);
+  region_round_touched_.assign(regions * REGION_WORDS, 0);
+  region_layer_pages_.assign(regions, { 0, 0, 0 });
+
+  region_lookup_.resize((total_pages + REGION_PAGES - 1) / REGION_PAGES);
+  uint64_t now_ms = PageMetadataArray::nowMs();
+  size_t region = 0;
+  for (size_t page_id = 0; page_id < total_pages; page_id++)
+  {
+    if (region_start_[region + 1] == page_id)
+    {
+      region++;
+    }
+    if (page_id % REGION_PAGES == 0)
+    {
+      region_lookup_[page_id / REGION_PAGES] = static_cast<uint32_t>(region);
+    }
+    region_layer_pages_[region][static_cast<size_t>(metadata_.layer(page_id))]++;
+  }
+  for (size_t r = 0; r < regions; r++)
+  {
+    region_metadata_.setLayer(r, metadata_.layer(region_start_[r]));
+    region_metadata_.setLastAccessTimeMs(r, now_ms);
+  }
+}
 
-      // Ensure the address is aligned to HUGE_PAGE_SIZE boundary
-      uintptr_t aligned_addr = reinterpret_cast<uintptr_t>(base) & ~(HUGE_PAGE_SIZE - 1);
-      size_t aligned_size = (num_pages * PAGE_SIZE) + (reinterpret_cast<uintptr_t>(base) - aligned_addr);
+void PageTable::_touchRegion(size_t page_id, uint64_t now_ms)
+{
+  size_t region = _regionOf(page_id);
+  region_metadata_.setLastAccessTimeMs(region, now_ms);
+  region_metadata_.incrementAccessCount(region, now_ms);
+
+  size_t offset = page_id - region_start_[region];
+  std::atomic<uint64_t>& word = region_touched_[region * REGION_WORDS + offset / 64];
+  uint64_t bit = 1ULL << (offset % 64);
+  // Skip the locked write when the bit is already set
+  if (!(word.load(std::memory_order_relaxed) & bit))
+  {
+    word.fetch_or(bit, std::memory_order_relaxed);
+  }
+}
 
-      // Round up to the nearest multiple of HUGE_PAGE_SIZE
-      aligned_size = (aligned_size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+void PageTable::_moveRegionPage(size_t page_id, PageLayer from, PageLayer to)
+{
+  size_t region = _regionOf(page_id);
+  std::array<uint16_t, 3>& pages = region_layer_pages_[region];
+  pages[static_cast<size_t>(from)]--;
+  pages[static_cast<size_t>(to)]++;
+
+  // Ties go to the faster layer
+  size_t majority = 0;
+  for (size_t layer = 1; layer < pages.size(); layer++)
+  {
+    if (pages[layer] > pages[majority])
+    {
+      majority = layer;
+    }
+  }
+  region_metadata_.setLayer(region, static_cast<PageLayer>(majority));
+}
 
-      int result = madvise(reinterpret_cast<void*>(aligned_addr), aligned_size, MADV_HUGEPAGE);
-      if (result != 0)
+LayerInfo* PageTable::_getLayerInfo(PageLayer layer)
+{
+  switch (layer)
+  {
+  case PageLayer::NUMA_LOCAL:
+    return &server_config_->local_numa;
+  case PageLayer::NUMA_REMOTE:
+    return &server_config_->remote_numa;
+  case PageLayer::PMEM:
+    return &server_config_->pmem;
+  }
+  return nullptr;
+}
+
+void PageTable::promoteToHugePage()
+{
+  if (server_config_->huge_page_policy == HugePagePolicy::ALL)
+  {
+    // Advice sticks to the mapping, once is enough
+    if (huge_pages_advised_)
+    {
+      return;
+    }
+    huge_pages_advised_ = true;
+    for (PageLayer layer : { PageLayer::NUMA_LOCAL, PageLayer::NUMA_REMOTE, PageLayer::PMEM })
+    {
+      void* bases[] = { local_base_, remote_base_, pmem_base_ };
+      void* base = bases[static_cast<size_t>(layer)];
+      if (base && madvise(base, backend_->tierBytes(layer), MADV_HUGEPAGE) != 0)
       {
-        LOG_DEBUG("Failed to promote " << region_name << " to huge pages: " << strerror(errno));
+        LOG_WARN("MADV_HUGEPAGE failed on " << layer << ": " << strerror(errno));
       }
-      else
+    }
+    return;
+  }
+  if (!huge_page_advisor_)
+  {
+    return;
+  }
+
+  // Count every page against the range holding it, accessed if it was
+  // touched since the previous round
+  auto countPage = [&](size_t page_id, bool accessed)
+    {
+      huge_page_advisor_->countPage(page_address_[page_id].load(std::memory_order_relaxed),
+        metadata_.layer(page_id), accessed);
+    };
+  if (region_mode_)
+  {
+    for (size_t region = 0; region < numRegions(); region++)
+    {
+      const uint64_t* touched = &region_round_touched_[region * REGION_WORDS];
+      for (size_t j = 0; j < regionSize(region); j++)
       {
-        LOG_DEBUG("Successfully promoted " << region_name << " to huge pages");
+        countPage(region_start_[region] + j, (touched[j / 64] >> (j % 64)) & 1);
       }
-    };
-
-  // Promote local NUMA pages
-  promoteRegion(local_base_, local_page_load_, "Local NUMA");
-
-  // Promote remote NUMA pages (if applicable)
-  if (server_config_->num_tiers == 3)
+    }
+  }
+  else
   {
-    promoteRegion(remote_base_, remote_page_load_, "Remote NUMA");
+    for (size_t word = 0; word < page_touched_.size(); word++)
+    {
+      uint64_t touched = page_touched_[word].exchange(0, std::memory_order_relaxed);
+      size_t first = word * 64;
+      for (size_t page_id = first; page_id < std::min(first + 64, metadata_.size()); page_id++)
+      {
+        countPage(page_id, (touched >> (page_id - first)) & 1);
+      }
+    }
   }
+  huge_page_advisor_->finishRound();
 
-  // Promote PMEM pages
-  promoteRegion(pmem_base_, pmem_page_load_, "PMEM");
+  std::ostringstream summary;
+  for (PageLayer layer : { PageLayer::NUMA_LOCAL, PageLayer::NUMA_REMOTE, PageLayer::PMEM })
+  {
+    const HugePageAdvisor::TierStats& stats = huge_page_advisor_->stats(layer);
+    if (stats.ranges == 0)
+    {
+      continue;
+    }
+    summary << (summary.tellp() > 0 ? "; " : "") << layer << " " << stats.backed_ranges << "/"
+      << stats.huge_ranges << " hot ranges backed, " << stats.no_huge_ranges << "/" << stats.ranges
+      << " kept small, +" << stats.promoted << " -" << stats.demoted << " advised, "
+      << stats.collapsed << " collapsed";
+  }
+  LOG_INFO("Huge pages: " << summary.str());
 }
 
 void PageTable::_allocateMemory()
 {
-  LOG_INFO("Allocating pages...");
+  LOG_INFO("Allocating pages with the " << backend_->name() << " tier backend...");
+  auto allocateTier = [&](PageLayer layer, size_t num_pages, size_t capacity)
+    {
+      void* base = backend_->allocateTier(layer, num_pages, capacity);
+      if (!base && num_pages > 0)
+      {
+        LOG_ERROR("Failed to allocate " << num_pages << " pages for " << layer
+          << ", use --tier-backend emulated on hosts without the NUMA nodes");
+        exit(EXIT_FAILURE);
+      }
+      return base;
+    };
+
   if (server_config_->num_tiers == 2)
   {
     // For 2 tiers, combine local and remote NUMA memory into DRAM
-    // Allocate local NUMA memory
-    local_base_ =
-      allocate_pages(PAGE_SIZE, local_page_load_ + remote_page_load_);
+    local_base_ = allocateTier(PageLayer::NUMA_LOCAL,
+      local_page_load_ + remote_page_load_, server_config_->local_numa.capacity);
   }
   else
   {
-    // Allocate local NUMA memory
-    local_base_ = allocate_and_bind_to_numa(PAGE_SIZE, local_page_load_, 0);
-    // Allocate memory for remote NUMA pages
-    remote_base_ = allocate_and_bind_to_numa(PAGE_SIZE, remote_page_load_, 1);
+    local_base_ = allocateTier(PageLayer::NUMA_LOCAL, local_page_load_,
+      server_config_->local_numa.capacity);
+    remote_base_ = allocateTier(PageLayer::NUMA_REMOTE, remote_page_load_,
+      server_config_->remote_numa.capacity);
   }
 
-  // Allocate PMEM memory
-  pmem_base_ = allocate_and_bind_to_numa(PAGE_SIZE, pmem_page_load_, 2);
+  pmem_base_ = allocateTier(PageLayer::PMEM, pmem_page_load_, server_config_->pmem.capacity);
 }
 
-void PageTable::_generateRandomContent()
+void PageTable::_generateContent()
 {
-  LOG_INFO("Generating random contents...");
-  // Seed the random number generator
-  srand(static_cast<unsigned>(time(NULL)));
-
-  size_t local_size = (server_config_->num_tiers == 2)
-    ? (local_page_load_ + remote_page_load_) * PAGE_SIZE
-    : local_page_load_ * PAGE_SIZE;
-  size_t remote_size =
-    (server_config_->num_tiers == 3) ? remote_page_load_ * PAGE_SIZE : 0;
-  size_t pmem_size = pmem_page_load_ * PAGE_SIZE;
-
-  LOG_DEBUG("Local size: " << local_size);
-  if (server_config_->num_tiers == 3)
+  size_t num_threads = server_config_->init_threads;
+  if (num_threads == 0)
   {
-    LOG_DEBUG("Remote size: " << remote_size);
+    num_threads = std::max<size_t>(1, boost::thread::hardware_concurrency());
   }
-  LOG_DEBUG("PMEM size: " << pmem_size);
+  LOG_INFO("Generating " << _contentName(server_config_->content) << " contents with "
+    << num_threads << " threads...");
 
-  // Fill numa local tier
+  std::pair<PageLayer, void*> tiers[] = { { PageLayer::NUMA_LOCAL, local_base_ },
+                                          { PageLayer::NUMA_REMOTE, remote_base_ },
+                                          { PageLayer::PMEM, pmem_base_ } };
+  for (auto& [layer, base] : tiers)
   {
-    unsigned char* base = static_cast<unsigned char*>(local_base_);
-    for (size_t i = 0; i < local_size; i++)
+    if (!base)
     {
-      base[i] = static_cast<unsigned char>(rand() % 256);
+      continue;
     }
+    size_t bytes = backend_->tierBytes(layer);
+    int node = backend_->numaNode(layer);
+
+    auto start = boost::chrono::steady_clock::now();
+    _fillRegion(static_cast<char*>(base), bytes, layer, node, num_threads);
+    double elapsed_ms = _elapsedMs(start);
+
+    LOG_INFO("  - " << layer << ": " << bytes / (1024 * 1024) << " MB in " << elapsed_ms
+      << " ms (" << (elapsed_ms > 0 ? bytes / elapsed_ms / 1e6 : 0) << " GB/s)"
+      << (node >= 0 ? ", node " + std::to_string(node) : std::string()));
   }
-  LOG_DEBUG("Random content generated for local numa node.");
+}
 
-  // Fill numa remote tier
-  if (server_config_->num_tiers == 3)
+void PageTable::_fillRegion(char* base, size_t bytes, PageLayer layer, int numa_node,
+  size_t num_threads)
+{
+  // Split on page boundaries, each thread writes (and so faults in) its own range
+  size_t pages = bytes / PAGE_SIZE;
+  size_t pages_per_thread = (pages + num_threads - 1) / num_threads;
+  ContentType content = server_config_->content;
+  uint64_t seed = static_cast<uint64_t>(time(NULL));
+
+  std::vector<boost::thread> threads;
+  for (size_t t = 0; t < num_threads && t * pages_per_thread < pages; t++)
   {
-    unsigned char* base = static_cast<unsigned char*>(remote_base_);
-    for (size_t i = 0; i < remote_size; i++)
-    {
-      base[i] = static_cast<unsigned char>(rand() % 256);
-    }
-    LOG_DEBUG("Random content generated for remote NUMA node.");
+    size_t first_page = t * pages_per_thread;
+    size_t num_pages = std::min(pages_per_thread, pages - first_page);
+    threads.emplace_back([=]()
+      {
+        if (numa_node >= 0 && !pin_thread_to_numa_node(numa_node))
+        {
+          LOG_DEBUG("Node " << numa_node << " has no CPUs, filling unpinned");
+        }
+
+        uint64_t* words = reinterpret_cast<uint64_t*>(base + first_page * PAGE_SIZE);
+        size_t num_words = num_pages * PAGE_SIZE / sizeof(uint64_t);
+        switch (content)
+        {
+        case ContentType::ZERO:
+          memset(words, 0, num_words * sizeof(uint64_t));
+          break;
+        case ContentType::RANDOM:
+        {
+          Xoshiro256Lanes rng(seed + first_page);
+          rng.fill(words, num_words);
+          break;
+        }
+        case ContentType::PATTERN:
+        {
+          // Tier in the top byte, word offset within the tier below it
+          uint64_t tag = static_cast<uint64_t>(layer) << 56;
+          uint64_t offset = first_page * PAGE_SIZE / sizeof(uint64_t);
+          for (size_t i = 0; i < num_words; i++)
+          {
+            words[i] = tag | (offset + i);
+          }
+          break;
+        }
+        }
+      });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
   }
+}
 
-  // Fill pmem tier
+const char* PageTable::_contentName(ContentType content)
+{
+  switch (content)
   {
-    unsigned char* base = static_cast<unsigned char*>(pmem_base_);
-    for (size_t i = 0; i < pmem_size; i++)
-    {
-      base[i] = static_cast<unsigned char>(rand() % 256);
-    }
-    LOG_DEBUG("Random content generated for persistent memory.");
+  case ContentType::ZERO:
+    return "zero";
+  case ContentType::RANDOM:
+    return "random";
+  case ContentType::PATTERN:
+    return "pattern";
   }
-}
\ No newline at end of file
+  return "unknown";
+}
+
+double PageTable::_elapsedMs(boost::chrono::steady_clock::time_point start)
+{
+  return boost::chrono::duration<double, boost::milli>(
+    boost::chrono::steady_clock::now() - start).count();
+}
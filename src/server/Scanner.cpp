@@ -1,114 +1,384 @@
 #include "Scanner.hpp"
 
-Scanner::Scanner(PageTable* page_table, PolicyConfig* policy_config)
-  : page_table_(page_table), policy_config_(policy_config) {
+namespace {
+
+// Largest value v with at most target samples <= v, or 0 if even the
+// lowest bucket holds more
+uint64_t lowestTail(const HistogramSnapshot& histogram, uint64_t target)
+{
+  uint64_t seen = 0;
+  for (size_t i = 0; i < histogram.counts.size(); i++)
+  {
+    seen += histogram.counts[i];
+    if (seen > target)
+    {
+      return i == 0 ? 0 : HistogramLayout::bucketLowerBound(i) - 1;
+    }
+  }
+  return histogram.max;
 }
 
-PageStatus Scanner::classifyPage(uint64_t last_access_time, uint32_t access_count) const
+// Smallest bucket upper bound v with at least target samples <= v
+uint64_t lowestCovering(const HistogramSnapshot& histogram, uint64_t target)
 {
-  if (classifyHotPage(last_access_time, access_count)) return PageStatus::HOT;
-  if (!classifyColdPage(last_access_time, access_count)) return PageStatus::WARM;
-  return PageStatus::COLD;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < histogram.counts.size(); i++)
+  {
+    seen += histogram.counts[i];
+    if (seen >= target)
+    {
+      return HistogramLayout::bucketLowerBound(i + 1) - 1;
+    }
+  }
+  return histogram.max;
 }
 
-bool Scanner::classifyHotPage(const uint64_t last_access_time, uint32_t access_count) const
+// Lowest value v with at least target samples >= v
+uint64_t highestTail(const HistogramSnapshot& histogram, uint64_t target)
 {
-  auto current_time = boost::chrono::steady_clock::now();
-  auto current_time_ms = boost::chrono::duration_cast<boost::chrono::milliseconds>(
-    current_time.time_since_epoch()).count();
-  auto time_since_last_access = current_time_ms - last_access_time;
+  uint64_t seen = 0;
+  for (size_t i = histogram.counts.size(); i-- > 0;)
+  {
+    seen += histogram.counts[i];
+    if (seen >= target)
+    {
+      return HistogramLayout::bucketLowerBound(i);
+    }
+  }
+  return 0;
+}
 
-  if (policy_config_->policy_type == "lru") {
-    auto& lru = std::get<LRUPolicyConfig>(policy_config_->config);
-    return time_since_last_access <= lru.hot_threshold_ms;
+} // namespace
+
+Scanner::Scanner(PageTable* page_table, PolicyConfig* policy_config,
+  ServerMemoryConfig* server_config, MigrationEngine* migration_engine)
+  : page_table_(page_table), policy_config_(policy_config),
+  server_config_(server_config), migration_engine_(migration_engine) {
+}
+
+size_t Scanner::_scanUnits() const
+{
+  return page_table_->regionMode() ? page_table_->numRegions() : page_table_->size();
+}
+
+void Scanner::runScanner(size_t num_tiers)
+{
+  size_t units = _scanUnits();
+  const char* unit_name = page_table_->regionMode() ? "regions" : "pages";
+  size_t num_threads = std::max<size_t>(std::min(policy_config_->scanner_threads, units), 1);
+  workers_.clear();
+  workers_.resize(num_threads);
+  for (size_t i = 0; i < num_threads; i++)
+  {
+    workers_[i].first_page = units * i / num_threads;
+    workers_[i].end_page = units * (i + 1) / num_threads;
   }
-  else if (policy_config_->policy_type == "frequency") {
-    auto& freq = std::get<FrequencyPolicyConfig>(policy_config_->config);
-    return access_count >= freq.hot_access_count;
+
+  double scan_rate = policy_config_->scan_rate > 0
+    ? static_cast<double>(policy_config_->scan_rate)
+    : (policy_config_->scan_interval > 0
+      ? static_cast<double>(units) / policy_config_->scan_interval : 0.0);
+  LOG_INFO("Scanner pacing: " << num_threads << " threads, "
+    << policy_config_->scan_chunk_size << " " << unit_name << " per chunk, "
+    << (scan_rate > 0 ? std::to_string(static_cast<size_t>(scan_rate)) + " " + unit_name + "/s"
+      : std::string("unthrottled")) << ", CPU budget "
+    << policy_config_->scan_cpu_budget << "% per thread, "
+    << PageClassifier::isaName(PageClassifier::bestIsa()) << " classifier");
+
+  boost::barrier barrier(static_cast<unsigned>(num_threads));
+  boost::thread_group threads;
+  for (size_t i = 1; i < num_threads; i++)
+  {
+    threads.create_thread(boost::bind(&Scanner::_runWorker, this, i, num_tiers,
+      boost::ref(barrier)));
   }
-  else if (policy_config_->policy_type == "hybrid") {
-    auto& hybrid = std::get<HybridPolicyConfig>(policy_config_->config);
-    double recency_score = (time_since_last_access <= hybrid.hot_threshold_ms) ? hybrid.weight_recency : 0.0;
-    double frequency_score = (access_count >= hybrid.hot_access_count) ? hybrid.weight_frequency : 0.0;
-    return (recency_score + frequency_score) >= (hybrid.weight_recency + hybrid.weight_frequency) / 2;
+  _runWorker(0, num_tiers, barrier);
+  threads.join_all();
+}
+
+void Scanner::_runWorker(size_t worker_id, size_t num_tiers, boost::barrier& barrier)
+{
+  typedef boost::chrono::steady_clock clock;
+  ScanWorker& worker = workers_[worker_id];
+  const size_t chunk_size = std::max<size_t>(policy_config_->scan_chunk_size, 1);
+  const double cpu_budget = policy_config_->scan_cpu_budget / 100.0;
+
+  // Every thread scans its share of the rate, a round spreads over the
+  // scan interval by default
+  size_t range_pages = worker.end_page - worker.first_page;
+  double scan_rate = policy_config_->scan_rate > 0
+    ? static_cast<double>(policy_config_->scan_rate) * range_pages / _scanUnits()
+    : (policy_config_->scan_interval > 0
+      ? static_cast<double>(range_pages) / policy_config_->scan_interval : 0.0);
+
+  while (true)
+  {
+    if (worker_id == 0)
+    {
+      // Only worker 0 decides to stop, so all threads leave together
+      stop_ = _shouldShutdown();
+      if (!stop_)
+      {
+        round_start_ = clock::now();
+        // Bring hardware hotness up to date before classifying the round
+        page_table_->sampleAccessBits();
+      }
+    }
+    barrier.wait();
+    if (stop_)
+    {
+      break;
+    }
+
+    // Thresholds only change between rounds
+    PageClassifier classifier(*policy_config_, num_tiers);
+    for (size_t first = worker.first_page; first < worker.end_page && !_shouldShutdown();
+      first += chunk_size)
+    {
+      size_t last = std::min(first + chunk_size, worker.end_page);
+      clock::time_point chunk_start = clock::now();
+      uint64_t now_ms = PageMetadataArray::nowMs();
+      for (size_t block = first; block < last; block += CLASSIFY_BLOCK_SIZE)
+      {
+        if (page_table_->regionMode())
+        {
+          _scanRegionBlock(worker, classifier, block, last - block, now_ms);
+        }
+        else
+        {
+          _scanBlock(worker, classifier, block, last - block, now_ms);
+        }
+      }
+      worker.round_pages += last - first;
+      clock::time_point chunk_end = clock::now();
+      worker.round_busy += chunk_end - chunk_start;
+      if (last == worker.end_page)
+      {
+        break;
+      }
+
+      // Wait for the later of the page schedule and the CPU budget
+      clock::time_point resume = chunk_end + boost::chrono::duration_cast<clock::duration>(
+        (chunk_end - chunk_start) * ((1.0 - cpu_budget) / cpu_budget));
+      if (scan_rate > 0)
+      {
+        resume = std::max(resume, round_start_ + boost::chrono::duration_cast<clock::duration>(
+          boost::chrono::duration<double>(worker.round_pages / scan_rate)));
+      }
+      if (resume > clock::now())
+      {
+        boost::this_thread::sleep_until(resume);
+      }
+    }
+
+    barrier.wait();
+    if (worker_id == 0)
+    {
+      _finishRound();
+    }
   }
-  return false;
 }
 
-bool Scanner::classifyColdPage(const uint64_t last_access_time, uint32_t access_count) const
+void Scanner::_finishRound()
 {
-  auto current_time = boost::chrono::steady_clock::now();
-  auto current_time_ms = boost::chrono::duration_cast<boost::chrono::milliseconds>(
-    current_time.time_since_epoch()).count();
-  auto time_since_last_access = current_time_ms - last_access_time;
+  typedef boost::chrono::steady_clock clock;
+  migration_engine_->flush();
+  if (policy_config_->adaptive_thresholds)
+  {
+    _adaptThresholds();
+  }
 
-  if (policy_config_->policy_type == "lru") {
-    auto& lru = std::get<LRUPolicyConfig>(policy_config_->config);
-    return time_since_last_access >= lru.cold_threshold_ms;
+  page_table_->promoteToHugePage();
+  clock::time_point round_end = clock::now();
+
+  size_t round_pages = 0;
+  size_t whole_regions = 0;
+  size_t split_regions = 0;
+  boost::chrono::nanoseconds max_busy(0);
+  for (ScanWorker& worker : workers_)
+  {
+    round_pages += worker.round_pages;
+    whole_regions += worker.round_whole_regions;
+    split_regions += worker.round_split_regions;
+    max_busy = std::max(max_busy, worker.round_busy);
+    worker.round_pages = 0;
+    worker.round_whole_regions = 0;
+    worker.round_split_regions = 0;
+    worker.round_busy = boost::chrono::nanoseconds(0);
   }
-  else if (policy_config_->policy_type == "frequency") {
-    auto& freq = std::get<FrequencyPolicyConfig>(policy_config_->config);
-    return access_count <= freq.cold_access_count;
+
+  // Lag is how far the round overran the scan interval
+  clock::time_point deadline = round_start_ + boost::chrono::seconds(policy_config_->scan_interval);
+  auto lag_ms = round_end > deadline
+    ? boost::chrono::duration_cast<boost::chrono::milliseconds>(round_end - deadline).count() : 0;
+  LOG_INFO("Scan round: " << round_pages << (page_table_->regionMode() ? " regions" : " pages")
+    << " in " << boost::chrono::duration_cast<boost::chrono::milliseconds>(round_end - round_start_).count()
+    << " ms (busiest thread " << boost::chrono::duration_cast<boost::chrono::milliseconds>(max_busy).count()
+    << " ms), lag " << lag_ms << " ms, " << migration_engine_->takeRejected()
+    << " decisions rejected for lack of room or a page in flight");
+  if (page_table_->regionMode())
+  {
+    LOG_INFO("Region decisions: " << whole_regions << " moved whole, " << split_regions
+      << " mixed, moved by page");
   }
-  else if (policy_config_->policy_type == "hybrid") {
-    auto& hybrid = std::get<HybridPolicyConfig>(policy_config_->config);
-    double recency_score = (time_since_last_access >= hybrid.cold_threshold_ms) ? hybrid.weight_recency : 0.0;
-    double frequency_score = (access_count <= hybrid.cold_access_count) ? hybrid.weight_frequency : 0.0;
-    return (recency_score + frequency_score) >= (hybrid.weight_recency + hybrid.weight_frequency) / 2;
+
+  // A late round starts the next one right away instead of catching up
+  if (round_end < deadline && !_shouldShutdown())
+  {
+    boost::this_thread::sleep_until(deadline);
   }
-  return false;
 }
 
-void Scanner::runScanner(size_t num_tiers)
+void Scanner::_scanBlock(ScanWorker& worker, const PageClassifier& classifier,
+  size_t first_page, size_t count, uint64_t now_ms)
 {
-  auto scan_start_time = boost::chrono::steady_clock::now();
-  while (!_shouldShutdown())
+  ClassifyBlock& block = worker.block;
+  page_table_->readBlock(first_page, count, now_ms, block);
+  if (policy_config_->adaptive_thresholds)
   {
-    size_t page_id = page_table_->scanNext();
-    PageLayer page_layer;
-    uint64_t last_access_time;
-    uint32_t access_cnt;
-    std::tie(page_layer, last_access_time, access_cnt) = page_table_->getPageMetaData(page_id);
+    for (size_t i = 0; i < block.size; i++)
+    {
+      _recordPage(worker, block.age_ms[i], block.count[i]);
+    }
+  }
 
-    PageStatus status = classifyPage(last_access_time, access_cnt);
+  MigrationMasks masks = classifier.targets(block);
+  const std::pair<uint64_t, PageLayer> moves[] = {
+    { masks.to_local, PageLayer::NUMA_LOCAL },
+    { masks.to_remote, PageLayer::NUMA_REMOTE },
+    { masks.to_pmem, PageLayer::PMEM } };
+  for (const auto& move : moves)
+  {
+    for (uint64_t mask = move.first; mask != 0; mask &= mask - 1)
+    {
+      size_t i = __builtin_ctzll(mask);
+      _queueMigration(first_page + i, static_cast<PageLayer>(block.layer[i]), move.second);
+    }
+  }
+}
 
-    switch (page_layer)
+void Scanner::_scanRegionBlock(ScanWorker& worker, const PageClassifier& classifier,
+  size_t first_region, size_t count, uint64_t now_ms)
+{
+  ClassifyBlock& block = worker.block;
+  RegionTouchBlock& touched = worker.touched;
+  page_table_->readRegionBlock(first_region, count, now_ms, block, touched);
+  if (policy_config_->adaptive_thresholds)
+  {
+    for (size_t i = 0; i < block.size; i++)
     {
-    case PageLayer::NUMA_LOCAL:
-      if (status == PageStatus::COLD)
-        page_table_->migratePage(page_id, num_tiers == 2 ? PageLayer::PMEM : PageLayer::NUMA_REMOTE);
-      break;
+      _recordPage(worker, block.age_ms[i], block.count[i]);
+    }
+  }
 
-    case PageLayer::NUMA_REMOTE:
-      if (status == PageStatus::COLD)
-        page_table_->migratePage(page_id, PageLayer::PMEM);
-      else if (classifyHotPage(last_access_time, access_cnt))
-        page_table_->migratePage(page_id, PageLayer::NUMA_LOCAL);
-      break;
+  MigrationMasks masks = classifier.targets(block);
+  const std::pair<uint64_t, PageLayer> moves[] = {
+    { masks.to_local, PageLayer::NUMA_LOCAL },
+    { masks.to_remote, PageLayer::NUMA_REMOTE },
+    { masks.to_pmem, PageLayer::PMEM } };
+  for (const auto& move : moves)
+  {
+    for (uint64_t mask = move.first; mask != 0; mask &= mask - 1)
+    {
+      size_t i = __builtin_ctzll(mask);
+      size_t region = first_region + i;
+      PageLayer source_layer = static_cast<PageLayer>(block.layer[i]);
+      bool promotion = move.second < source_layer;
+      size_t size = page_table_->regionSize(region);
+      size_t backing = promotion ? touched.count[i] : size - touched.count[i];
+      if (backing * 100 >= size * server_config_->region_density)
+      {
+        // A rejected region counts with the rejected decisions
+        worker.round_whole_regions += migration_engine_->submitRegion(region, source_layer,
+          move.second);
+        continue;
+      }
 
-    case PageLayer::PMEM:
-      if (status == PageStatus::HOT)
-        page_table_->migratePage(page_id, PageLayer::NUMA_LOCAL);
-      else if (status == PageStatus::WARM)
-        page_table_->migratePage(page_id, num_tiers == 2 ? PageLayer::NUMA_LOCAL : PageLayer::NUMA_REMOTE);
-      break;
+      worker.region_pages.clear();
+      page_table_->selectRegionPages(region, move.second, touched.bits[i], promotion,
+        worker.region_pages);
+      for (size_t page_id : worker.region_pages)
+      {
+        _queueMigration(page_id, page_table_->pageLayer(page_id), move.second);
+      }
+      worker.round_split_regions++;
     }
+  }
+}
 
-    if (page_id == page_table_->size() - 1)
-    {
+void Scanner::_recordPage(ScanWorker& worker, uint64_t age_ms, uint32_t access_count)
+{
+  worker.recency_histogram.counts[HistogramLayout::bucketIndex(age_ms)]++;
+  worker.recency_histogram.count++;
+  worker.recency_histogram.max = std::max(worker.recency_histogram.max, age_ms);
+  worker.frequency_histogram.counts[HistogramLayout::bucketIndex(access_count)]++;
+  worker.frequency_histogram.count++;
+  worker.frequency_histogram.max = std::max<uint64_t>(worker.frequency_histogram.max, access_count);
+}
+
+void Scanner::_adaptThresholds()
+{
+  HistogramSnapshot recency_histogram;
+  HistogramSnapshot frequency_histogram;
+  for (ScanWorker& worker : workers_)
+  {
+    recency_histogram.merge(worker.recency_histogram);
+    frequency_histogram.merge(worker.frequency_histogram);
+    worker.recency_histogram = HistogramSnapshot();
+    worker.frequency_histogram = HistogramSnapshot();
+  }
 
-      auto scan_end_time = boost::chrono::steady_clock::now();
-      auto scan_duration = boost::chrono::duration_cast<boost::chrono::seconds>(scan_end_time - scan_start_time).count();
-      LOG_INFO("finished scanning all pages in one round at " << scan_duration << " seconds");
+  // Ideal placement ranks pages by hotness: the first local capacity pages
+  // are hot, pages beyond the local and remote capacity belong in the
+  // slowest tier and are cold, the rest are warm. Regions are ranked the
+  // same against capacities in regions.
+  uint64_t unit_pages = page_table_->regionMode() ? REGION_PAGES : 1;
+  uint64_t pages = recency_histogram.count;
+  uint64_t hot_pages = std::min<uint64_t>(server_config_->local_numa.capacity / unit_pages, pages);
+  uint64_t fast_pages = (server_config_->local_numa.capacity +
+    (server_config_->num_tiers == 3 ? server_config_->remote_numa.capacity : 0)) / unit_pages;
+  uint64_t cold_pages = pages > fast_pages ? pages - fast_pages : 0;
 
-      page_table_->promoteToHugePage();
-      auto promotion_end_time = boost::chrono::steady_clock::now();
-      auto promotion_duration = boost::chrono::duration_cast<boost::chrono::seconds>(promotion_end_time - scan_end_time).count();
-      LOG_INFO("finished promotion pages at " << promotion_duration << " seconds");
-      boost::this_thread::sleep_for(
-        boost::chrono::seconds(policy_config_->scan_interval));
-    }
+  // Hot sets may fall short of the target on ties, cold sets may exceed it
+  // so that every page that has to leave the faster tiers can
+  size_t hot_age_ms = lowestTail(recency_histogram, hot_pages);
+  size_t cold_age_ms = cold_pages == 0
+    ? std::numeric_limits<size_t>::max() : highestTail(recency_histogram, cold_pages);
+  // Everything above the pages - hot_pages least accessed is hot, so a
+  // never-accessed page is never hot
+  size_t hot_count = lowestCovering(frequency_histogram, pages - hot_pages) + 1;
+  // With no cold target only pages without recent accesses are cold
+  size_t cold_count = cold_pages == 0 ? 0 : lowestCovering(frequency_histogram, cold_pages);
+
+  if (policy_config_->policy_type == "lru") {
+    auto& lru = std::get<LRUPolicyConfig>(policy_config_->config);
+    lru.hot_threshold_ms = hot_age_ms;
+    lru.cold_threshold_ms = cold_age_ms;
   }
+  else if (policy_config_->policy_type == "frequency") {
+    auto& freq = std::get<FrequencyPolicyConfig>(policy_config_->config);
+    freq.hot_access_count = hot_count;
+    freq.cold_access_count = cold_count;
+  }
+  else if (policy_config_->policy_type == "hybrid") {
+    auto& hybrid = std::get<HybridPolicyConfig>(policy_config_->config);
+    hybrid.hot_threshold_ms = hot_age_ms;
+    hybrid.cold_threshold_ms = cold_age_ms;
+    hybrid.hot_access_count = hot_count;
+    hybrid.cold_access_count = cold_count;
+  }
+
+  LOG_INFO("Adaptive thresholds for " << pages << " pages (" << hot_pages << " hot, "
+    << cold_pages << " cold): hot age <= " << hot_age_ms << " ms, count >= " << hot_count
+    << "; cold age >= " << (cold_pages ? std::to_string(cold_age_ms) + " ms" : std::string("never"))
+    << ", count <= " << cold_count);
+}
+
+void Scanner::_queueMigration(size_t page_id, PageLayer source_layer, PageLayer target_layer)
+{
+  // Blocks while the migration queue is full, dropped when the target
+  // layer has no room left or the page is moving elsewhere
+  migration_engine_->submit(page_id, source_layer, target_layer);
 }
 
 bool Scanner::_shouldShutdown()
@@ -1,12 +1,26 @@
 #include "Server.hpp"
 
-Server::Server(RingBuffer<ClientMessage>& client_buffer,
+Server::Server(const std::vector<RingBuffer<ClientMessage>*>& client_buffers,
   const std::vector<ClientConfig>& client_configs,
   ServerMemoryConfig* server_config, PolicyConfig* policy_config,
-  bool use_cache_ring, size_t sample_rate, const std::string periodic_metric_filename)
-  : client_buffer_(client_buffer), sample_rate_(sample_rate),
-  server_config_(server_config),
+  bool use_cache_ring, size_t sample_rate, size_t batch_size,
+  size_t manager_threads, const std::string periodic_metric_filename)
+  : sample_rate_(sample_rate), batch_size_(batch_size),
+  server_config_(server_config), num_clients_(client_configs.size()),
   periodic_metric_filename_(periodic_metric_filename) {
+  // Clocks first, page metadata takes timestamps from the start
+  CoarseClock::start(server_config_->clock_source);
+  LatencyTimer::start(server_config_->latency_timer);
+
+  // Buffer i is served by worker i % N, so a client's requests always land
+  // on the same worker and page id ranges are never shared between workers
+  for (size_t i = 0; i < manager_threads; i++) {
+    workers_.push_back(std::make_unique<ManagerWorker>());
+  }
+  for (size_t i = 0; i < client_buffers.size(); i++) {
+    workers_[i % manager_threads]->buffers.push_back(client_buffers[i]);
+  }
+
   // Calculate load memory pages
   size_t client_total_page = 0;
   if (server_config_->num_tiers == 2) {
@@ -26,27 +40,30 @@ Server::Server(RingBuffer<ClientMessage>& client_buffer,
   }
 
   page_table_ = new PageTable(client_configs, server_config, use_cache_ring);
+  page_table_->setAccessHalfLife(policy_config->half_life_ms);
   page_table_->initPageTable();
 
-  scanner_ = new Scanner(page_table_, policy_config);
-
-  client_done_flags_ = std::vector<bool>(client_configs.size(), false);
+  migration_engine_ = new MigrationEngine(page_table_,
+    policy_config->migration_threads, policy_config->migration_queue_size,
+    policy_config->migration_batch_size,
+    policy_config->migration_flush_interval_ms);
+  scanner_ = new Scanner(page_table_, policy_config, server_config, migration_engine_);
 }
 
 Server::~Server() {
-  delete page_table_;
   delete scanner_;
+  delete migration_engine_;
+  delete page_table_;
+  CoarseClock::stop();
 }
 
 // Helper function to handle a ClientMessage
 void Server::handleClientMessage(const ClientMessage& msg) {
   if (msg.op_type == OperationType::END) {
-    client_done_flags_[msg.client_id] = true;
     LOG_DEBUG("Client " << msg.client_id << " sent END command.");
 
-    // Check if all clients are done
-    if (std::all_of(client_done_flags_.begin(), client_done_flags_.end(),
-      [](bool done) { return done; })) {
+    // Check if all clients are done, each client sends END exactly once
+    if (clients_done_.fetch_add(1) + 1 == num_clients_) {
       LOG_INFO("All clients sent END command.");
       signalShutdown();
     }
@@ -55,27 +72,47 @@ void Server::handleClientMessage(const ClientMessage& msg) {
 
   size_t page_index = base_page_id_[msg.client_id] + msg.pid;
   page_table_->accessPage(page_index, msg.op_type);
+
+  // Open-loop requests: latency counts from when the client meant to send
+  if (msg.scheduled_ns != 0) {
+    uint64_t now_ns = boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+      boost::chrono::steady_clock::now().time_since_epoch()).count();
+    Metrics::getInstance().recordEndToEndLatency(
+      now_ns > msg.scheduled_ns ? now_ns - msg.scheduled_ns : 0);
+  }
 }
 
-void Server::_runManagerThread() {
-  LOG_INFO("Manager thread start!");
+void Server::_runManagerThread(size_t worker_id) {
+  LOG_INFO("Manager thread " << worker_id << " start!");
+  ManagerWorker& worker = *workers_[worker_id];
+  std::vector<ClientMessage> batch(batch_size_,
+    ClientMessage(0, 0, 0, OperationType::READ));
+
   while (!_shouldShutdown()) {
-    ClientMessage client_msg(0, 0, 0, OperationType::READ);
     bool didwork = false;
 
-    // Get memory request from client
-    if (client_buffer_.pop(client_msg)) {
-      LOG_DEBUG("Server received: " << client_msg.toString());
-      handleClientMessage(client_msg);
-      didwork = true;
+    // Get memory requests from clients, one batch per queue per round
+    for (RingBuffer<ClientMessage>* client_buffer : worker.buffers) {
+      size_t popped = client_buffer->popBatch(batch.data(), batch.size());
+      for (size_t i = 0; i < popped; i++) {
+        LOG_DEBUG("Server received: " << batch[i].toString());
+        handleClientMessage(batch[i]);
+      }
+      if (popped > 0) {
+        worker.handled_requests.fetch_add(popped, std::memory_order_relaxed);
+        didwork = true;
+      }
     }
 
     // Sleep if no works was done
     if (!didwork) {
+      worker.idle_rounds.fetch_add(1, std::memory_order_relaxed);
       boost::this_thread::sleep_for(boost::chrono::nanoseconds(100));
     }
   }
-  LOG_INFO("Manager thread exiting...");
+  LOG_INFO("Manager thread " << worker_id << " exiting, handled "
+    << worker.handled_requests.load() << " requests, idle rounds "
+    << worker.idle_rounds.load());
 }
 
 void Server::_runScannerThread() {
@@ -99,24 +136,30 @@ void Server::_runPeriodicalMetricsThread() {
 
 void Server::signalShutdown() {
   scanner_->signalShutdown();
-  boost::lock_guard<boost::mutex> lock(manager_shutdown_mutex_);
-  manager_shutdown_flag_ = true;
+  migration_engine_->signalShutdown();
+  manager_shutdown_flag_.store(true, std::memory_order_release);
 }
 
 bool Server::_shouldShutdown() {
-  boost::lock_guard<boost::mutex> lock(manager_shutdown_mutex_);
-  return manager_shutdown_flag_;
+  return manager_shutdown_flag_.load(std::memory_order_acquire);
 }
 
 // Main function to start threads
 void Server::start() {
-  boost::thread server_thread(&Server::_runManagerThread, this);
+  migration_engine_->start();
+  std::vector<boost::thread> manager_threads;
+  for (size_t i = 0; i < workers_.size(); i++) {
+    manager_threads.emplace_back(&Server::_runManagerThread, this, i);
+  }
   boost::thread policy_thread(&Server::_runScannerThread, this);
   boost::thread periodical_metric_thread(&Server::_runPeriodicalMetricsThread,
     this);
   // Join threads
-  server_thread.join();
+  for (auto& thread : manager_threads) {
+    thread.join();
+  }
   policy_thread.join();
+  migration_engine_->join();
   periodical_metric_thread.join();
 
   LOG_INFO("All threads exited. Server shutdown complete.");
@@ -0,0 +1,203 @@
+#include "TierBackend.hpp"
+
+NumaTierBackend::~NumaTierBackend()
+{
+  for (PageLayer layer : { PageLayer::NUMA_LOCAL, PageLayer::NUMA_REMOTE, PageLayer::PMEM })
+  {
+    releaseTier(layer);
+  }
+}
+
+void* NumaTierBackend::allocateTier(PageLayer layer, size_t num_pages, size_t capacity)
+{
+  size_t tier = static_cast<size_t>(layer);
+  if (num_pages == 0)
+  {
+    return nullptr;
+  }
+
+  if (numaNode(layer) < 0)
+  {
+    base_[tier] = allocate_pages(PAGE_SIZE, num_pages);
+  }
+  else
+  {
+    base_[tier] = allocate_and_bind_to_numa(PAGE_SIZE, num_pages, numaNode(layer));
+  }
+  size_[tier] = base_[tier] ? num_pages * PAGE_SIZE : 0;
+  return base_[tier];
+}
+
+void NumaTierBackend::releaseTier(PageLayer layer)
+{
+  size_t tier = static_cast<size_t>(layer);
+  if (base_[tier])
+  {
+    munmap(base_[tier], size_[tier]);
+    base_[tier] = nullptr;
+  }
+}
+
+void NumaTierBackend::migratePages(void** pages, size_t number, PageLayer target_layer,
+  bool* moved)
+{
+  std::vector<int> status(number);
+  int target_node = layer_to_numa_node(target_layer);
+  move_page_list_to_node(pages, number, target_node, status.data());
+  for (size_t i = 0; i < number; i++)
+  {
+    moved[i] = status[i] == target_node;
+  }
+}
+
+EmulatedTierBackend::~EmulatedTierBackend()
+{
+  for (PageLayer layer : { PageLayer::NUMA_LOCAL, PageLayer::NUMA_REMOTE, PageLayer::PMEM })
+  {
+    releaseTier(layer);
+  }
+}
+
+void* EmulatedTierBackend::allocateTier(PageLayer layer, size_t num_pages, size_t capacity)
+{
+  Tier& tier = tiers_[static_cast<size_t>(layer)];
+  capacity = std::max(capacity, num_pages);
+  if (capacity == 0)
+  {
+    return nullptr;
+  }
+
+  // Reserve the whole capacity so pages can migrate in
+  tier.base = static_cast<char*>(allocate_pages(PAGE_SIZE, capacity));
+  tier.capacity = capacity;
+
+  // Slots [0, num_pages) hold the initial pages, lowest free slot is used first
+  tier.free_slots.clear();
+  for (size_t slot = capacity; slot > num_pages; slot--)
+  {
+    tier.free_slots.push_back(slot - 1);
+  }
+  return tier.base;
+}
+
+void EmulatedTierBackend::releaseTier(PageLayer layer)
+{
+  Tier& tier = tiers_[static_cast<size_t>(layer)];
+  if (tier.base)
+  {
+    munmap(tier.base, tier.capacity * PAGE_SIZE);
+    tier.base = nullptr;
+    tier.capacity = 0;
+    tier.free_slots.clear();
+  }
+}
+
+uint64_t EmulatedTierBackend::accessPage(void* addr, PageLayer layer, OperationType mode)
+{
+  uint64_t access_time = access_page(addr, mode);
+  return access_time + _injectDelay(layer, CACHE_LINE_SIZE, true);
+}
+
+void EmulatedTierBackend::migratePages(void** pages, size_t number, PageLayer target_layer,
+  bool* moved)
+{
+  Tier& target = tiers_[static_cast<size_t>(target_layer)];
+  std::vector<Tier*> sources(number, nullptr);
+  std::vector<char*> destinations(number, nullptr);
+
+  // Claim target slots for the whole batch
+  {
+    boost::lock_guard<boost::mutex> lock(slot_mutex_);
+    for (size_t i = 0; i < number; i++)
+    {
+      sources[i] = _tierOf(pages[i]);
+      if (!sources[i] || sources[i] == &target || target.free_slots.empty())
+      {
+        continue;
+      }
+      destinations[i] = target.base + target.free_slots.back() * PAGE_SIZE;
+      target.free_slots.pop_back();
+    }
+  }
+
+  // Copy outside the lock, paying both tiers' bandwidth
+  for (size_t i = 0; i < number; i++)
+  {
+    moved[i] = sources[i] == &target;
+    if (!destinations[i])
+    {
+      continue;
+    }
+    memcpy(destinations[i], pages[i], PAGE_SIZE);
+    _injectDelay(static_cast<PageLayer>(sources[i] - tiers_), PAGE_SIZE, false);
+    _injectDelay(target_layer, PAGE_SIZE, false);
+  }
+
+  // Free the source slots and hand back the new addresses
+  boost::lock_guard<boost::mutex> lock(slot_mutex_);
+  for (size_t i = 0; i < number; i++)
+  {
+    if (!destinations[i])
+    {
+      continue;
+    }
+    char* source_addr = static_cast<char*>(pages[i]);
+    sources[i]->free_slots.push_back((source_addr - sources[i]->base) / PAGE_SIZE);
+    pages[i] = destinations[i];
+    moved[i] = true;
+  }
+}
+
+uint64_t EmulatedTierBackend::_injectDelay(PageLayer layer, size_t bytes, bool with_latency)
+{
+  size_t tier = static_cast<size_t>(layer);
+  uint64_t start = LatencyTimer::nowNs();
+  uint64_t finish = start;
+
+  // Serialize transfers on the tier: take the next free window of its bandwidth.
+  // MB/s is bytes per microsecond.
+  if (config_.bandwidth_mbps[tier] > 0)
+  {
+    uint64_t cost = bytes * 1000 / config_.bandwidth_mbps[tier];
+    std::atomic<uint64_t>& busy_until = tiers_[tier].busy_until_ns;
+    uint64_t busy = busy_until.load(std::memory_order_relaxed);
+    uint64_t begin;
+    do
+    {
+      begin = std::max(busy, start);
+    } while (!busy_until.compare_exchange_weak(busy, begin + cost, std::memory_order_relaxed));
+    finish = begin + cost;
+  }
+  if (with_latency)
+  {
+    finish += config_.latency_ns[tier];
+  }
+
+  while (LatencyTimer::nowNs() < finish)
+  {
+    _mm_pause();
+  }
+  return finish - start;
+}
+
+EmulatedTierBackend::Tier* EmulatedTierBackend::_tierOf(void* addr)
+{
+  char* page = static_cast<char*>(addr);
+  for (Tier& tier : tiers_)
+  {
+    if (tier.base && page >= tier.base && page < tier.base + tier.capacity * PAGE_SIZE)
+    {
+      return &tier;
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<TierBackend> createTierBackend(const ServerMemoryConfig& config)
+{
+  if (config.backend.type == TierBackendType::EMULATED)
+  {
+    return std::make_unique<EmulatedTierBackend>(config.backend);
+  }
+  return std::make_unique<NumaTierBackend>(config.num_tiers);
+}
@@ -0,0 +1,115 @@
+#include "Timing.hpp"
+
+#include <cpuid.h>
+
+#include "Logger.hpp"
+
+ClockSource CoarseClock::source_ = ClockSource::STEADY;
+std::atomic<uint64_t> CoarseClock::ticker_ms_{ 0 };
+std::atomic<bool> CoarseClock::ticker_stop_{ false };
+boost::thread CoarseClock::ticker_;
+
+void CoarseClock::start(ClockSource source)
+{
+  stop();
+  if (source == ClockSource::TICKER)
+  {
+    // Valid before the thread first runs
+    ticker_ms_.store(_readMs(CLOCK_MONOTONIC), std::memory_order_relaxed);
+    ticker_stop_.store(false, std::memory_order_relaxed);
+    ticker_ = boost::thread(&CoarseClock::_runTicker);
+  }
+  source_ = source;
+}
+
+void CoarseClock::stop()
+{
+  if (ticker_.joinable())
+  {
+    ticker_stop_.store(true, std::memory_order_relaxed);
+    ticker_.join();
+  }
+  source_ = ClockSource::STEADY;
+}
+
+void CoarseClock::_runTicker()
+{
+  while (!ticker_stop_.load(std::memory_order_relaxed))
+  {
+    ticker_ms_.store(_readMs(CLOCK_MONOTONIC), std::memory_order_relaxed);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+  }
+}
+
+const char* CoarseClock::sourceName(ClockSource source)
+{
+  switch (source)
+  {
+  case ClockSource::COARSE:
+    return "coarse";
+  case ClockSource::TICKER:
+    return "ticker";
+  default:
+    return "steady";
+  }
+}
+
+LatencyTimerSource LatencyTimer::source_ = LatencyTimerSource::CLOCK;
+double LatencyTimer::ns_per_tick_ = 0.0;
+uint64_t LatencyTimer::base_tsc_ = 0;
+uint64_t LatencyTimer::base_ns_ = 0;
+
+void LatencyTimer::start(LatencyTimerSource source)
+{
+  if (source == LatencyTimerSource::TSC && !_invariantTsc())
+  {
+    LOG_WARN("TSC is not invariant, timing latency with clock_gettime");
+    source = LatencyTimerSource::CLOCK;
+  }
+  if (source == LatencyTimerSource::TSC && ns_per_tick_ == 0.0)
+  {
+    _calibrate();
+    LOG_INFO("TSC calibrated at " << tscGhz() << " GHz");
+  }
+  source_ = source;
+}
+
+bool LatencyTimer::_invariantTsc()
+{
+  unsigned int eax, ebx, ecx, edx;
+  return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8));
+}
+
+void LatencyTimer::_calibrate()
+{
+  // Pair a clock read with the counter values around it, the narrowest
+  // bracket of a few tries pins the pair best
+  auto sample = [](uint64_t& tsc, uint64_t& ns) {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 16; i++)
+    {
+      uint64_t before = _readTsc();
+      uint64_t clock_ns = _clockNs();
+      uint64_t after = _readTsc();
+      if (after - before < best)
+      {
+        best = after - before;
+        tsc = before + (after - before) / 2;
+        ns = clock_ns;
+      }
+    }
+  };
+
+  uint64_t start_tsc = 0, start_ns = 0, end_tsc = 0, end_ns = 0;
+  sample(start_tsc, start_ns);
+  boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+  sample(end_tsc, end_ns);
+  ns_per_tick_ = static_cast<double>(end_ns - start_ns) / static_cast<double>(end_tsc - start_tsc);
+  base_tsc_ = end_tsc;
+  base_ns_ = end_ns;
+}
+
+const char* LatencyTimer::sourceName(LatencyTimerSource source)
+{
+  return source == LatencyTimerSource::TSC ? "tsc" : "clock";
+}
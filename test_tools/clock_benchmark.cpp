@@ -0,0 +1,113 @@
+// Clock source benchmark: cost and staleness of page access timestamps,
+// cost and accuracy of the access latency timers.
+//
+// Timestamps: the steady_clock + duration_cast read the page table used per
+// access, against each CoarseClock source. Staleness is how far a source
+// trails a precise millisecond read taken right after it.
+// Latency timers: the cost of an empty begin/elapsedNs pair, which every
+// measured access pays, and the error over a known interval.
+
+#include <algorithm>
+#include <boost/chrono.hpp>
+#include <boost/thread/thread.hpp>
+#include <cstdio>
+
+#include "Logger.hpp"
+#include "Timing.hpp"
+
+#define CALLS 20000000
+#define STALENESS_SAMPLES 2000000
+#define TIMER_PAIRS 10000000
+#define INTERVAL_MS 20
+
+static double elapsed_ns(boost::chrono::steady_clock::time_point start)
+{
+  return static_cast<double>(boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+    boost::chrono::steady_clock::now() - start).count());
+}
+
+static uint64_t steady_ms()
+{
+  return boost::chrono::duration_cast<boost::chrono::milliseconds>(
+    boost::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main()
+{
+  volatile uint64_t sink = 0;
+
+  printf("Timestamps (%d calls)\n", CALLS);
+  printf("%-22s %-12s %-16s %s\n", "Source", "ns/call", "mean stale (ms)", "max stale (ms)");
+  auto start = boost::chrono::steady_clock::now();
+  for (size_t i = 0; i < CALLS; i++)
+  {
+    sink += steady_ms();
+  }
+  printf("%-22s %-12.2f %-16s %s\n", "steady_clock::now()", elapsed_ns(start) / CALLS, "-", "-");
+
+  for (ClockSource source : { ClockSource::STEADY, ClockSource::COARSE, ClockSource::TICKER })
+  {
+    CoarseClock::start(source);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+    start = boost::chrono::steady_clock::now();
+    for (size_t i = 0; i < CALLS; i++)
+    {
+      sink += CoarseClock::nowMs();
+    }
+    double cost = elapsed_ns(start) / CALLS;
+
+    uint64_t total_stale = 0;
+    uint64_t max_stale = 0;
+    for (size_t i = 0; i < STALENESS_SAMPLES; i++)
+    {
+      uint64_t stamp = CoarseClock::nowMs();
+      uint64_t precise = steady_ms();
+      uint64_t stale = precise > stamp ? precise - stamp : 0;
+      total_stale += stale;
+      max_stale = std::max(max_stale, stale);
+    }
+    CoarseClock::stop();
+
+    char name[32];
+    snprintf(name, sizeof(name), "CoarseClock %s", CoarseClock::sourceName(source));
+    printf("%-22s %-12.2f %-16.3f %llu\n", name, cost,
+      static_cast<double>(total_stale) / STALENESS_SAMPLES, (unsigned long long)max_stale);
+  }
+
+  // Calibrate up front, keeping its log line out of the table
+  LatencyTimer::start(LatencyTimerSource::TSC);
+  printf("\nLatency timers (%d begin/elapsedNs pairs, %d ms interval)\n", TIMER_PAIRS, INTERVAL_MS);
+  printf("%-22s %-12s %-16s %s\n", "Timer", "ns/pair", "interval (ns)", "error (ns)");
+  for (LatencyTimerSource source : { LatencyTimerSource::CLOCK, LatencyTimerSource::TSC })
+  {
+    LatencyTimer::start(source);
+    if (LatencyTimer::source() != source)
+    {
+      printf("%-22s unavailable\n", LatencyTimer::sourceName(source));
+      continue;
+    }
+    start = boost::chrono::steady_clock::now();
+    for (size_t i = 0; i < TIMER_PAIRS; i++)
+    {
+      sink += LatencyTimer::elapsedNs(LatencyTimer::begin());
+    }
+    double cost = elapsed_ns(start) / TIMER_PAIRS;
+
+    // Same interval measured by CLOCK_MONOTONIC and by the timer
+    auto reference = boost::chrono::steady_clock::now();
+    uint64_t timer_start = LatencyTimer::begin();
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(INTERVAL_MS));
+    uint64_t measured = LatencyTimer::elapsedNs(timer_start);
+    double actual = elapsed_ns(reference);
+
+    char name[32];
+    snprintf(name, sizeof(name), "LatencyTimer %s", LatencyTimer::sourceName(source));
+    printf("%-22s %-12.2f %-16llu %+.0f\n", name, cost, (unsigned long long)measured,
+      static_cast<double>(measured) - actual);
+  }
+  if (LatencyTimer::tscGhz() > 0)
+  {
+    printf("TSC calibrated at %.4f GHz\n", LatencyTimer::tscGhz());
+  }
+  return 0;
+}
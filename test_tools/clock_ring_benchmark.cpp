@@ -0,0 +1,331 @@
+// Clock ring benchmark: linked-list ring vs array-backed ClockRing.
+//
+// Replays page traces through a NUMA_LOCAL-sized ring the way the page
+// table drives it: hits mark the page, misses evict a victim and insert
+// the new page. The legacy ring allocates a node per insert and sweeps
+// through list pointers, ClockRing sweeps byte lanes over a fixed slot
+// array, as plain CLOCK (max count 1) and as GCLOCK.
+//
+// Skewed trace: ns per access and hit ratio, then the worst case eviction:
+// every page at the max count, the hand decrements max count full turns.
+// Scan trace: a hot set with bursts of one-touch pages, like a batch job
+// sweeping memory. Reports the hit ratio of the hot pages, which CLOCK
+// loses to every burst longer than the ring.
+
+#include <boost/chrono.hpp>
+#include <cassert>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "ClockRing.hpp"
+
+#define ACCESSES (1 << 24)
+#define HOT_SHARE 0.9
+#define SWEEPS 20
+#define SCAN_BURSTS 64
+#define GCLOCK_MAX_COUNT 3
+
+// Ring before the array-backed rewrite
+struct LegacyClockRingNode
+{
+  size_t page_id;
+  std::atomic<bool> ref_bit;
+  LegacyClockRingNode* prev;
+  LegacyClockRingNode* next;
+
+  LegacyClockRingNode(size_t pid) : page_id(pid), ref_bit(false), prev(nullptr), next(nullptr) {}
+};
+
+class LegacyClockRing
+{
+public:
+  ~LegacyClockRing()
+  {
+    while (size_ > 0)
+    {
+      LegacyClockRingNode* node = hand_;
+      hand_ = hand_->next;
+      delete node;
+      size_--;
+    }
+  }
+
+  LegacyClockRingNode* insert(size_t page_id)
+  {
+    LegacyClockRingNode* node = new LegacyClockRingNode(page_id);
+    if (!hand_)
+    {
+      hand_ = node->next = node->prev = node;
+    }
+    else
+    {
+      LegacyClockRingNode* tail = hand_->prev;
+      tail->next = node;
+      node->prev = tail;
+      node->next = hand_;
+      hand_->prev = node;
+    }
+    ++size_;
+    return node;
+  }
+
+  void remove(LegacyClockRingNode* node)
+  {
+    if (node->next == node)
+    {
+      hand_ = nullptr;
+    }
+    else
+    {
+      node->prev->next = node->next;
+      node->next->prev = node->prev;
+      if (hand_ == node)
+        hand_ = node->next;
+    }
+    delete node;
+    --size_;
+  }
+
+  size_t findEvictionCandidate()
+  {
+    while (true)
+    {
+      if (!hand_->ref_bit.load(std::memory_order_relaxed))
+      {
+        size_t victim = hand_->page_id;
+        LegacyClockRingNode* evicted = hand_;
+        hand_ = hand_->next;
+        remove(evicted);
+        return victim;
+      }
+      hand_->ref_bit.store(false, std::memory_order_relaxed);
+      hand_ = hand_->next;
+    }
+  }
+
+private:
+  LegacyClockRingNode* hand_ = nullptr;
+  size_t size_ = 0;
+};
+
+static double elapsed_ns(boost::chrono::steady_clock::time_point start)
+{
+  return static_cast<double>(boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+    boost::chrono::steady_clock::now() - start).count());
+}
+
+struct ReplayResult
+{
+  double ns = 0;
+  size_t misses = 0;
+  size_t hot_accesses = 0;
+  size_t hot_misses = 0;
+};
+
+// Pages below hot_pages count as hot. Both rings start full with the
+// highest pages, which no trace touches first.
+static ReplayResult replay_legacy(LegacyClockRing& ring, std::vector<LegacyClockRingNode*>& nodes,
+  size_t capacity, const std::vector<uint32_t>& trace, size_t hot_pages)
+{
+  size_t num_pages = nodes.size();
+  for (size_t i = 0; i < capacity; i++)
+  {
+    nodes[num_pages - 1 - i] = ring.insert(num_pages - 1 - i);
+  }
+  ReplayResult result;
+  auto start = boost::chrono::steady_clock::now();
+  for (uint32_t page : trace)
+  {
+    bool hot = page < hot_pages;
+    result.hot_accesses += hot;
+    if (nodes[page])
+    {
+      nodes[page]->ref_bit.store(true, std::memory_order_relaxed);
+      continue;
+    }
+    result.misses++;
+    result.hot_misses += hot;
+    size_t victim = ring.findEvictionCandidate();
+    nodes[victim] = nullptr;
+    nodes[page] = ring.insert(page);
+  }
+  result.ns = elapsed_ns(start);
+  return result;
+}
+
+static ReplayResult replay_array(ClockRing& ring, std::vector<std::atomic<ClockRing::Handle>>& handles,
+  const std::vector<uint32_t>& trace, size_t hot_pages)
+{
+  size_t num_pages = handles.size();
+  for (std::atomic<ClockRing::Handle>& handle : handles)
+  {
+    handle.store(ClockRing::NO_HANDLE, std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < ring.capacity(); i++)
+  {
+    ring.insert(num_pages - 1 - i, handles[num_pages - 1 - i]);
+  }
+  ReplayResult result;
+  auto start = boost::chrono::steady_clock::now();
+  for (uint32_t page : trace)
+  {
+    bool hot = page < hot_pages;
+    result.hot_accesses += hot;
+    ClockRing::Handle handle = handles[page].load(std::memory_order_relaxed);
+    if (handle != ClockRing::NO_HANDLE)
+    {
+      ring.markAccessed(handle);
+      continue;
+    }
+    result.misses++;
+    result.hot_misses += hot;
+    size_t victim;
+    bool evicted = ring.findEvictionCandidate(victim, handle);
+    assert(evicted);
+    (void)evicted;
+    handles[victim].store(ClockRing::NO_HANDLE, std::memory_order_relaxed);
+    bool inserted = ring.insert(page, handles[page]);
+    assert(inserted);
+    (void)inserted;
+  }
+  result.ns = elapsed_ns(start);
+  return result;
+}
+
+static double hit_ratio(size_t misses, size_t accesses)
+{
+  return accesses ? 1.0 - static_cast<double>(misses) / accesses : 0.0;
+}
+
+static void report(const char* name, const ReplayResult& result, size_t accesses, double sweep_ns)
+{
+  printf("%-10s %-12.2f %-12.4f %.3f\n", name, result.ns / accesses,
+    hit_ratio(result.misses, accesses), sweep_ns / 1e6);
+}
+
+static void run_benchmark(size_t capacity)
+{
+  // Pages span four rings' worth, HOT_SHARE of accesses go to a hot set
+  // of half the ring
+  size_t num_pages = capacity * 4;
+  size_t hot_pages = capacity / 2;
+  std::mt19937_64 rng(7);
+  std::uniform_real_distribution<double> coin(0.0, 1.0);
+  std::uniform_int_distribution<size_t> hot(0, hot_pages - 1);
+  std::uniform_int_distribution<size_t> any(0, num_pages - 1);
+  std::vector<uint32_t> trace(ACCESSES);
+  for (uint32_t& page : trace)
+  {
+    page = static_cast<uint32_t>(coin(rng) < HOT_SHARE ? hot(rng) : any(rng));
+  }
+
+  printf("Ring of %zu pages, %zu pages, %d accesses\n", capacity, num_pages, ACCESSES);
+  printf("%-10s %-12s %-12s %s\n", "Ring", "ns/access", "Hit ratio", "Full sweep (ms)");
+
+  {
+    LegacyClockRing ring;
+    std::vector<LegacyClockRingNode*> nodes(num_pages, nullptr);
+    ReplayResult result = replay_legacy(ring, nodes, capacity, trace, hot_pages);
+
+    double sweep_ns = 0;
+    for (size_t round = 0; round < SWEEPS; round++)
+    {
+      for (LegacyClockRingNode* node : nodes)
+      {
+        if (node)
+          node->ref_bit.store(true, std::memory_order_relaxed);
+      }
+      auto start = boost::chrono::steady_clock::now();
+      size_t victim = ring.findEvictionCandidate();
+      sweep_ns += elapsed_ns(start);
+      nodes[victim] = ring.insert(victim);
+    }
+    report("legacy", result, ACCESSES, sweep_ns / SWEEPS);
+  }
+
+  for (uint32_t max_count : { 1u, static_cast<uint32_t>(GCLOCK_MAX_COUNT) })
+  {
+    ClockRing ring(capacity, max_count);
+    std::vector<std::atomic<ClockRing::Handle>> handles(num_pages);
+    ReplayResult result = replay_array(ring, handles, trace, hot_pages);
+
+    double sweep_ns = 0;
+    for (size_t round = 0; round < SWEEPS; round++)
+    {
+      for (uint32_t mark = 0; mark < max_count; mark++)
+      {
+        for (std::atomic<ClockRing::Handle>& handle : handles)
+        {
+          ring.markAccessed(handle.load(std::memory_order_relaxed));
+        }
+      }
+      size_t victim;
+      ClockRing::Handle handle;
+      auto start = boost::chrono::steady_clock::now();
+      ring.findEvictionCandidate(victim, handle);
+      sweep_ns += elapsed_ns(start);
+      ring.insert(victim, handles[victim]);
+    }
+    report(max_count == 1 ? "clock" : "gclock", result, ACCESSES, sweep_ns / SWEEPS);
+  }
+  printf("\n");
+}
+
+static void run_scan_benchmark(size_t capacity)
+{
+  // A hot set of a quarter of the ring, broken up by bursts that touch
+  // twice the ring's worth of pages once each
+  size_t hot_pages = capacity / 4;
+  size_t burst = capacity * 2;
+  size_t num_pages = hot_pages + burst * SCAN_BURSTS + capacity;
+  size_t between = ACCESSES / SCAN_BURSTS - burst;
+  std::mt19937_64 rng(11);
+  std::uniform_int_distribution<size_t> hot(0, hot_pages - 1);
+  std::vector<uint32_t> trace;
+  trace.reserve(ACCESSES);
+  size_t next_scanned = hot_pages;
+  for (size_t round = 0; round < SCAN_BURSTS; round++)
+  {
+    for (size_t i = 0; i < between; i++)
+    {
+      trace.push_back(static_cast<uint32_t>(hot(rng)));
+    }
+    for (size_t i = 0; i < burst; i++)
+    {
+      trace.push_back(static_cast<uint32_t>(next_scanned++));
+    }
+  }
+
+  printf("Scan resistance: ring of %zu pages, hot set %zu, %d bursts of %zu one-touch pages\n",
+    capacity, hot_pages, SCAN_BURSTS, burst);
+  printf("%-10s %-12s %-12s %s\n", "Ring", "ns/access", "Hit ratio", "Hot hit ratio");
+  auto report_scan = [&](const char* name, const ReplayResult& result)
+    {
+      printf("%-10s %-12.2f %-12.4f %.4f\n", name, result.ns / trace.size(),
+        hit_ratio(result.misses, trace.size()), hit_ratio(result.hot_misses, result.hot_accesses));
+    };
+
+  {
+    LegacyClockRing ring;
+    std::vector<LegacyClockRingNode*> nodes(num_pages, nullptr);
+    report_scan("legacy", replay_legacy(ring, nodes, capacity, trace, hot_pages));
+  }
+  for (uint32_t max_count : { 1u, 2u, static_cast<uint32_t>(GCLOCK_MAX_COUNT), 7u })
+  {
+    ClockRing ring(capacity, max_count);
+    std::vector<std::atomic<ClockRing::Handle>> handles(num_pages);
+    char name[16];
+    snprintf(name, sizeof(name), max_count == 1 ? "clock" : "gclock-%u", max_count);
+    report_scan(name, replay_array(ring, handles, trace, hot_pages));
+  }
+  printf("\n");
+}
+
+int main()
+{
+  run_benchmark(1 << 16);
+  run_benchmark(1 << 20);
+  run_scan_benchmark(1 << 16);
+  return 0;
+}
@@ -0,0 +1,209 @@
+// Clock ring stress test: concurrent mark, insert, remove and evict.
+//
+// Markers hit random pages' handles, migration workers evict a victim and
+// insert an outside page in its place, removers take random pages out by
+// handle and retry the dead handle. Every page's handle lives in one
+// atomic, as in PageMetadataArray. Checks that every eviction finds the
+// victim's handle published and the victim in the ring, that dead handles
+// never remove anything, and that the ring drains to exactly the pages the
+// handles say it holds. Exits non-zero on any violation.
+
+#include <boost/bind/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread/thread.hpp>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "ClockRing.hpp"
+
+#define CAPACITY 4096
+#define PAGES (CAPACITY * 2)
+#define MARKERS 2
+#define MIGRATION_WORKERS 4
+#define REMOVERS 2
+#define DURATION_MS 3000
+
+enum PageState : uint8_t
+{
+  OUT, // Not in the ring, free to insert
+  IN   // Claimed by an inserter or in the ring
+};
+
+static ClockRing ring(CAPACITY, 3);
+static std::vector<std::atomic<ClockRing::Handle>> handles(PAGES);
+static std::vector<std::atomic<uint8_t>> states(PAGES);
+static std::atomic<bool> stop{ false };
+static std::atomic<uint64_t> violations{ 0 };
+static std::atomic<uint64_t> marks{ 0 }, inserts{ 0 }, evictions{ 0 }, removes{ 0 },
+  stale_removes{ 0 };
+
+static void violation(const char* what, size_t page)
+{
+  if (violations.fetch_add(1) < 10)
+  {
+    fprintf(stderr, "violation: %s (page %zu)\n", what, page);
+  }
+}
+
+// Put an outside page in the ring
+static bool insert_page(std::mt19937_64& rng)
+{
+  size_t page = rng() % PAGES;
+  uint8_t expected = OUT;
+  if (!states[page].compare_exchange_strong(expected, IN))
+  {
+    return false;
+  }
+  if (!ring.insert(page, handles[page]))
+  {
+    states[page].store(OUT);
+    return false;
+  }
+  inserts.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+// Bookkeeping for a page the ring handed out with handle
+static void take_out(size_t page, ClockRing::Handle handle, const char* who)
+{
+  if (states[page].load() != IN)
+  {
+    violation(who, page);
+  }
+  ClockRing::Handle expected = handle;
+  if (!handles[page].compare_exchange_strong(expected, ClockRing::NO_HANDLE))
+  {
+    violation("handle not published", page);
+  }
+  states[page].store(OUT);
+}
+
+static void run_marker(uint64_t seed)
+{
+  std::mt19937_64 rng(seed);
+  uint64_t count = 0;
+  while (!stop.load(std::memory_order_relaxed))
+  {
+    ring.markAccessed(handles[rng() % PAGES].load(std::memory_order_relaxed));
+    count++;
+  }
+  marks.fetch_add(count);
+}
+
+static void run_migration_worker(uint64_t seed)
+{
+  std::mt19937_64 rng(seed);
+  while (!stop.load(std::memory_order_relaxed))
+  {
+    size_t victim;
+    ClockRing::Handle handle;
+    if (ring.findEvictionCandidate(victim, handle))
+    {
+      take_out(victim, handle, "evicted page not in ring");
+      evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    while (!insert_page(rng) && !stop.load(std::memory_order_relaxed))
+    {
+    }
+  }
+}
+
+static void run_remover(uint64_t seed)
+{
+  std::mt19937_64 rng(seed);
+  while (!stop.load(std::memory_order_relaxed))
+  {
+    size_t page = rng() % PAGES;
+    ClockRing::Handle handle = handles[page].load();
+    if (handle == ClockRing::NO_HANDLE || !ring.remove(handle))
+    {
+      continue;
+    }
+    take_out(page, handle, "removed page not in ring");
+    removes.fetch_add(1, std::memory_order_relaxed);
+
+    // The handle is dead now, whatever holds the slot next
+    if (ring.remove(handle))
+    {
+      violation("dead handle removed a page", page);
+    }
+    stale_removes.fetch_add(1, std::memory_order_relaxed);
+    while (!insert_page(rng) && !stop.load(std::memory_order_relaxed))
+    {
+    }
+  }
+}
+
+int main()
+{
+  for (size_t i = 0; i < PAGES; i++)
+  {
+    handles[i].store(ClockRing::NO_HANDLE);
+    states[i].store(OUT);
+  }
+  std::mt19937_64 rng(1);
+  while (ring.size() < CAPACITY)
+  {
+    insert_page(rng);
+  }
+
+  printf("Ring of %d slots, %d pages: %d markers, %d migration workers, %d removers, %d ms\n",
+    CAPACITY, PAGES, MARKERS, MIGRATION_WORKERS, REMOVERS, DURATION_MS);
+  boost::thread_group threads;
+  uint64_t seed = 100;
+  for (size_t i = 0; i < MARKERS; i++)
+  {
+    threads.create_thread(boost::bind(run_marker, seed++));
+  }
+  for (size_t i = 0; i < MIGRATION_WORKERS; i++)
+  {
+    threads.create_thread(boost::bind(run_migration_worker, seed++));
+  }
+  for (size_t i = 0; i < REMOVERS; i++)
+  {
+    threads.create_thread(boost::bind(run_remover, seed++));
+  }
+  boost::this_thread::sleep_for(boost::chrono::milliseconds(DURATION_MS));
+  stop.store(true);
+  threads.join_all();
+
+  double seconds = DURATION_MS / 1000.0;
+  printf("%-16s %12s %14s\n", "Operation", "Count", "ops/s");
+  const char* names[] = { "mark", "insert", "evict", "remove", "dead remove" };
+  uint64_t counts[] = { marks.load(), inserts.load(), evictions.load(), removes.load(),
+                        stale_removes.load() };
+  for (size_t i = 0; i < 5; i++)
+  {
+    printf("%-16s %12llu %14.0f\n", names[i], (unsigned long long)counts[i], counts[i] / seconds);
+  }
+
+  // Quiescent now: the ring must hold exactly the pages with a handle
+  size_t held = 0;
+  for (size_t i = 0; i < PAGES; i++)
+  {
+    held += handles[i].load() != ClockRing::NO_HANDLE;
+  }
+  if (held != ring.size())
+  {
+    fprintf(stderr, "violation: %zu pages hold handles, ring size %zu\n", held, ring.size());
+    violations++;
+  }
+  size_t drained = 0;
+  size_t victim;
+  ClockRing::Handle handle;
+  while (ring.findEvictionCandidate(victim, handle))
+  {
+    take_out(victim, handle, "drained page not in ring");
+    drained++;
+  }
+  if (drained != held || !ring.empty())
+  {
+    fprintf(stderr, "violation: drained %zu of %zu pages, %zu left\n", drained, held, ring.size());
+    violations++;
+  }
+
+  printf("Drained %zu pages, %llu violations: %s\n", drained,
+    (unsigned long long)violations.load(), violations.load() ? "FAILED" : "OK");
+  return violations.load() ? 1 : 0;
+}
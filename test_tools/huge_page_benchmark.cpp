@@ -0,0 +1,248 @@
+// Huge page benchmark: dTLB misses of the local tier under each huge page
+// policy.
+//
+// Maps a local tier, faults it in 4 KB pages, then backs it per policy:
+// none leaves it in 4 KB pages, all collapses every range like a blanket
+// MADV_HUGEPAGE once khugepaged has caught up, hot runs HugePageAdvisor
+// rounds over a skewed trace until it stops collapsing. Every fourth range
+// is hot and takes HOT_SHARE of the accesses, spread over all its pages.
+// The rest are touched sparsely.
+//
+// Replays the trace with mem_inst_retired.stlb_miss_loads and all_loads,
+// the raw events benchmark.c counts, and reports STLB misses per thousand
+// loads next to the memory each policy puts in huge pages.
+
+#include <boost/chrono.hpp>
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <random>
+#include <sys/ioctl.h>
+#include <vector>
+
+#include "HugePageAdvisor.hpp"
+
+#define TIER_BYTES (512UL * 1024 * 1024)
+#define TIER_PAGES (TIER_BYTES / PAGE_SIZE)
+#define RANGE_PAGES (HUGE_PAGE_SIZE / PAGE_SIZE)
+#define HOT_EVERY 4
+#define HOT_SHARE 0.9
+#define ACCESSES (1 << 24)
+#define MAX_ROUNDS 16
+
+#ifndef MADV_COLLAPSE
+#define MADV_COLLAPSE 25
+#endif
+
+// STLB load misses and retired loads, -1 where perf is unavailable
+struct TlbCounters
+{
+  int fd_misses = -1;
+  int fd_loads = -1;
+};
+
+static int open_raw_counter(uint64_t config)
+{
+  struct perf_event_attr pe;
+  memset(&pe, 0, sizeof(pe));
+  pe.type = PERF_TYPE_RAW;
+  pe.size = sizeof(pe);
+  pe.config = config;
+  pe.disabled = 1;
+  pe.exclude_kernel = 1;
+  pe.exclude_hv = 1;
+  return static_cast<int>(syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0));
+}
+
+static TlbCounters setup_tlb_counters()
+{
+  TlbCounters counters;
+  counters.fd_misses = open_raw_counter(0x11d0); // mem_inst_retired.stlb_miss_loads
+  counters.fd_loads = open_raw_counter(0x81d0);  // mem_inst_retired.all_loads
+  if (counters.fd_misses < 0 || counters.fd_loads < 0)
+  {
+    fprintf(stderr, "Warning: STLB counters not available (%s), reporting time only\n",
+      strerror(errno));
+  }
+  return counters;
+}
+
+static double elapsed_ns(boost::chrono::steady_clock::time_point start)
+{
+  return static_cast<double>(boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+    boost::chrono::steady_clock::now() - start).count());
+}
+
+// Page of each access: HOT_SHARE to the hot ranges, the rest anywhere
+static std::vector<uint32_t> make_trace(size_t accesses, uint64_t seed)
+{
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> coin(0.0, 1.0);
+  std::uniform_int_distribution<size_t> hot_range(0, TIER_PAGES / RANGE_PAGES / HOT_EVERY - 1);
+  std::uniform_int_distribution<size_t> in_range(0, RANGE_PAGES - 1);
+  std::uniform_int_distribution<size_t> any(0, TIER_PAGES - 1);
+  std::vector<uint32_t> trace(accesses);
+  for (uint32_t& page : trace)
+  {
+    page = static_cast<uint32_t>(coin(rng) < HOT_SHARE
+      ? hot_range(rng) * HOT_EVERY * RANGE_PAGES + in_range(rng) : any(rng));
+  }
+  return trace;
+}
+
+// Huge pages backing [base, base + bytes), from /proc/self/smaps
+static size_t huge_pages_in(char* base, size_t bytes)
+{
+  FILE* smaps = fopen("/proc/self/smaps", "r");
+  if (!smaps)
+  {
+    return 0;
+  }
+  char line[256];
+  unsigned long start = 0, end = 0, vma_start, vma_end;
+  size_t huge_kb, total = 0;
+  while (fgets(line, sizeof(line), smaps))
+  {
+    if (sscanf(line, "%lx-%lx ", &vma_start, &vma_end) == 2)
+    {
+      start = vma_start;
+      end = vma_end;
+    }
+    else if (sscanf(line, "AnonHugePages: %zu kB", &huge_kb) == 1 &&
+      start < reinterpret_cast<uintptr_t>(base) + bytes && end > reinterpret_cast<uintptr_t>(base))
+    {
+      total += huge_kb * 1024 / HUGE_PAGE_SIZE;
+    }
+  }
+  fclose(smaps);
+  return total;
+}
+
+// One scan round: the pages a round's worth of accesses touch
+static void run_round(HugePageAdvisor& advisor, char* tier, const std::vector<uint32_t>& trace,
+  size_t first, std::vector<uint8_t>& accessed)
+{
+  accessed.assign(TIER_PAGES, 0);
+  for (size_t i = first; i < first + TIER_PAGES; i++)
+  {
+    accessed[trace[i % trace.size()]] = 1;
+  }
+  for (size_t page = 0; page < TIER_PAGES; page++)
+  {
+    advisor.countPage(tier + page * PAGE_SIZE, PageLayer::NUMA_LOCAL, accessed[page]);
+  }
+  advisor.finishRound();
+}
+
+static void run_policy(const char* policy, const std::vector<uint32_t>& trace,
+  const TlbCounters& counters, double& baseline_mpki)
+{
+  char* tier = static_cast<char*>(map_huge_aligned(TIER_BYTES));
+  if (tier == MAP_FAILED)
+  {
+    perror("mmap failed");
+    exit(EXIT_FAILURE);
+  }
+  // Faulted in 4 KB pages, THP only comes from the policy
+  madvise(tier, TIER_BYTES, MADV_NOHUGEPAGE);
+  memset(tier, 1, TIER_BYTES);
+  madvise(tier, TIER_BYTES, MADV_HUGEPAGE);
+
+  size_t rounds = 0;
+  auto start = boost::chrono::steady_clock::now();
+  if (strcmp(policy, "all") == 0)
+  {
+    for (size_t offset = 0; offset < TIER_BYTES; offset += HUGE_PAGE_SIZE)
+    {
+      madvise(tier + offset, HUGE_PAGE_SIZE, MADV_COLLAPSE);
+    }
+  }
+  else if (strcmp(policy, "hot") == 0)
+  {
+    HugePageAdvisor advisor(50);
+    advisor.addTier(PageLayer::NUMA_LOCAL, tier, TIER_BYTES);
+    std::vector<uint8_t> accessed;
+    do
+    {
+      run_round(advisor, tier, trace, rounds * TIER_PAGES, accessed);
+      rounds++;
+    } while (advisor.stats(PageLayer::NUMA_LOCAL).collapsed > 0 && rounds < MAX_ROUNDS);
+  }
+  else
+  {
+    madvise(tier, TIER_BYTES, MADV_NOHUGEPAGE);
+  }
+  double advise_ms = elapsed_ns(start) / 1e6;
+  size_t huge_pages = huge_pages_in(tier, TIER_BYTES);
+
+  bool counting = counters.fd_misses >= 0 && counters.fd_loads >= 0;
+  if (counting)
+  {
+    for (int fd : { counters.fd_misses, counters.fd_loads })
+    {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+  uint64_t sum = 0;
+  start = boost::chrono::steady_clock::now();
+  for (uint32_t page : trace)
+  {
+    sum += *reinterpret_cast<volatile uint64_t*>(tier + page * PAGE_SIZE + (page % 64) * 64);
+  }
+  double ns = elapsed_ns(start) / trace.size();
+  uint64_t misses = 0, loads = 0;
+  if (counting)
+  {
+    ioctl(counters.fd_misses, PERF_EVENT_IOC_DISABLE, 0);
+    ioctl(counters.fd_loads, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(counters.fd_misses, &misses, sizeof(misses)) != sizeof(misses) ||
+      read(counters.fd_loads, &loads, sizeof(loads)) != sizeof(loads))
+    {
+      counting = false;
+    }
+  }
+
+  printf("%-8s %-10zu %-8zu %-11.1f %-11.2f", policy, huge_pages * HUGE_PAGE_SIZE >> 20, rounds,
+    advise_ms, ns);
+  if (counting && loads > 0)
+  {
+    double mpki = 1000.0 * misses / loads;
+    if (baseline_mpki < 0)
+    {
+      baseline_mpki = mpki;
+    }
+    printf(" %-18.3f %.1f%%\n", mpki,
+      baseline_mpki > 0 ? 100.0 * (baseline_mpki - mpki) / baseline_mpki : 0.0);
+  }
+  else
+  {
+    printf(" %-18s %s\n", "n/a", "n/a");
+  }
+  munmap(tier, TIER_BYTES);
+  (void)sum;
+}
+
+int main()
+{
+  TlbCounters counters = setup_tlb_counters();
+  std::vector<uint32_t> trace = make_trace(ACCESSES, 3);
+
+  printf("Local tier of %lu MB (%lu ranges), one range in %d hot with %.0f%% of %d accesses\n",
+    TIER_BYTES >> 20, TIER_PAGES / RANGE_PAGES, HOT_EVERY, HOT_SHARE * 100, ACCESSES);
+  printf("%-8s %-10s %-8s %-11s %-11s %-18s %s\n", "Policy", "Huge (MB)", "Rounds", "Advise (ms)",
+    "ns/access", "STLB misses/1k ld", "Reduction");
+  double baseline_mpki = -1;
+  for (const char* policy : { "none", "all", "hot" })
+  {
+    run_policy(policy, trace, counters, baseline_mpki);
+  }
+  for (int fd : { counters.fd_misses, counters.fd_loads })
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,106 @@
+// Latency recording benchmark: boost extended_p_square vs LatencyHistogram.
+//
+// Measures the cost of recording one sample, as Metrics::recordAccessLatency
+// does on every access, and compares tail percentiles against the exact
+// values from the sorted samples.
+
+#include <algorithm>
+#include <boost/accumulators/accumulators.hpp>
+#include <boost/accumulators/statistics/extended_p_square.hpp>
+#include <boost/accumulators/statistics/max.hpp>
+#include <boost/accumulators/statistics/mean.hpp>
+#include <boost/accumulators/statistics/min.hpp>
+#include <boost/accumulators/statistics/stats.hpp>
+#include <boost/chrono.hpp>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "LatencyHistogram.hpp"
+
+#define SAMPLES (1 << 24)
+
+namespace acc = boost::accumulators;
+
+static const double probabilities[] = { 0.5, 0.9, 0.99, 0.999, 0.9999 };
+
+static double elapsed_ns(boost::chrono::steady_clock::time_point start)
+{
+  return static_cast<double>(boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+    boost::chrono::steady_clock::now() - start).count());
+}
+
+int main()
+{
+  // Access latencies: a DRAM-like body with a long tail
+  std::mt19937_64 rng(42);
+  std::lognormal_distribution<double> body(5.0, 0.4);
+  std::exponential_distribution<double> tail(1.0 / 5000.0);
+  std::uniform_real_distribution<double> pick(0.0, 1.0);
+  std::vector<uint64_t> samples(SAMPLES);
+  for (uint64_t& sample : samples)
+  {
+    sample = static_cast<uint64_t>(pick(rng) < 0.01 ? 1000 + tail(rng) : body(rng));
+  }
+
+  // Boost accumulator used by Metrics before the histogram
+  using AccumulatorType = acc::accumulator_set<
+    uint64_t, acc::stats<acc::tag::mean, acc::tag::min, acc::tag::max,
+    acc::tag::extended_p_square>>;
+  AccumulatorType accumulator{ acc::tag::extended_p_square::probabilities = probabilities };
+  auto start = boost::chrono::steady_clock::now();
+  for (uint64_t sample : samples)
+  {
+    accumulator(sample);
+  }
+  double accumulator_ns = elapsed_ns(start) / SAMPLES;
+
+  LatencyHistogram histogram;
+  start = boost::chrono::steady_clock::now();
+  for (uint64_t sample : samples)
+  {
+    histogram.record(sample);
+  }
+  double histogram_ns = elapsed_ns(start) / SAMPLES;
+
+  printf("Record cost (ns/sample): accumulator %.2f, histogram %.2f\n",
+    accumulator_ns, histogram_ns);
+
+  // Concurrent writers on one histogram
+  for (size_t threads = 2; threads <= 8; threads *= 2)
+  {
+    LatencyHistogram shared;
+    size_t per_thread = SAMPLES / threads;
+    start = boost::chrono::steady_clock::now();
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < threads; t++)
+    {
+      writers.emplace_back([&shared, &samples, t, per_thread]() {
+        for (size_t i = t * per_thread; i < (t + 1) * per_thread; i++)
+        {
+          shared.record(samples[i]);
+        }
+        });
+    }
+    for (auto& writer : writers)
+    {
+      writer.join();
+    }
+    printf("Histogram with %zu writers: %.2f ns/sample (wall)\n", threads,
+      elapsed_ns(start) / (per_thread * threads));
+  }
+
+  // Accuracy against exact percentiles
+  HistogramSnapshot snapshot = histogram.snapshot();
+  std::sort(samples.begin(), samples.end());
+  printf("%-10s %-12s %-12s %-12s\n", "Quantile", "Exact", "Accumulator", "Histogram");
+  for (size_t i = 0; i < std::size(probabilities); i++)
+  {
+    size_t rank = static_cast<size_t>(probabilities[i] * SAMPLES);
+    printf("%-10g %-12llu %-12.0f %-12llu\n", probabilities[i],
+      (unsigned long long)samples[rank - 1], acc::extended_p_square(accumulator)[i],
+      (unsigned long long)snapshot.percentile(probabilities[i]));
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+// Metrics update benchmark: shared atomic counters vs per-thread shards.
+//
+// Every served request bumps one tier access counter and records its latency.
+// This measures that cost per request as the number of manager threads grows,
+// once with all threads hitting the same atomics (the previous Metrics layout)
+// and once through Metrics, which gives each thread its own shard.
+
+#include <atomic>
+#include <boost/chrono.hpp>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "LatencyHistogram.hpp"
+#include "Metrics.hpp"
+
+#define UPDATES_PER_THREAD (1 << 23)
+#define MAX_THREADS 16
+
+// Counters as Metrics kept them before sharding
+struct SharedCounters
+{
+  std::atomic<uint64_t> local_access_count{ 0 };
+  std::atomic<uint64_t> remote_access_count{ 0 };
+  std::atomic<uint64_t> pmem_access_count{ 0 };
+  std::atomic<uint64_t> total_latency{ 0 };
+  LatencyHistogram access_latency;
+};
+
+template <typename Update>
+static double run(size_t threads, Update update)
+{
+  std::vector<std::thread> workers;
+  auto start = boost::chrono::steady_clock::now();
+  for (size_t t = 0; t < threads; t++)
+  {
+    workers.emplace_back([&update, t]() {
+      for (uint64_t i = 0; i < UPDATES_PER_THREAD; i++)
+      {
+        update(t + i, 100 + (i & 0xff));
+      }
+      });
+  }
+  for (auto& worker : workers)
+  {
+    worker.join();
+  }
+  auto elapsed = boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+    boost::chrono::steady_clock::now() - start).count();
+  // Wall time per update on each thread, flat means no contention
+  return static_cast<double>(elapsed) / UPDATES_PER_THREAD;
+}
+
+int main()
+{
+  printf("%-8s %-16s %-16s\n", "Threads", "Shared (ns)", "Sharded (ns)");
+  for (size_t threads = 1; threads <= MAX_THREADS; threads *= 2)
+  {
+    SharedCounters shared;
+    double shared_ns = run(threads, [&shared](uint64_t key, uint64_t latency) {
+      switch (key % 3)
+      {
+      case 0: shared.local_access_count++; break;
+      case 1: shared.remote_access_count++; break;
+      default: shared.pmem_access_count++; break;
+      }
+      shared.access_latency.record(latency);
+      shared.total_latency += latency;
+      });
+
+    Metrics& metrics = Metrics::getInstance();
+    metrics.reset();
+    double sharded_ns = run(threads, [&metrics](uint64_t key, uint64_t latency) {
+      switch (key % 3)
+      {
+      case 0: metrics.incrementLocalAccess(); break;
+      case 1: metrics.incrementRemoteAccess(); break;
+      default: metrics.incrementPmemAccess(); break;
+      }
+      metrics.recordAccessLatency(latency);
+      });
+
+    printf("%-8zu %-16.2f %-16.2f\n", threads, shared_ns, sharded_ns);
+  }
+  return 0;
+}
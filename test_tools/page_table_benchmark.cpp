@@ -0,0 +1,120 @@
+// Page table lookup microbenchmark: boost::unordered_map vs dense SoA array.
+//
+// Replays the manager thread's access path (load layer, timestamp and count
+// for a random page id) against the legacy hash-map layout and against
+// PageMetadataArray, at 1M and 16M pages.
+
+#include <boost/chrono.hpp>
+#include <boost/unordered_map.hpp>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "PageMetadata.hpp"
+
+#define LOOKUPS (1 << 24)
+
+// Layout of the page table entry before the dense page table
+struct LegacyPageMetadata
+{
+  std::atomic<PageLayer> page_layer;
+  std::atomic<uint64_t> last_access_time_ms;
+  std::atomic<uint32_t> access_cnt;
+  std::atomic<void*> ring_node_ptr;
+
+  LegacyPageMetadata(PageLayer layer = PageLayer::NUMA_LOCAL)
+    : page_layer(layer), last_access_time_ms(0), access_cnt(0), ring_node_ptr(nullptr) {
+  }
+};
+
+struct LegacyPageTableEntry
+{
+  void* page_address;
+  LegacyPageMetadata metadata;
+
+  LegacyPageTableEntry(void* addr = 0, PageLayer layer = PageLayer::NUMA_LOCAL)
+    : page_address(addr), metadata(layer) {
+  }
+};
+
+static double elapsed_ns(boost::chrono::steady_clock::time_point start)
+{
+  return static_cast<double>(boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+    boost::chrono::steady_clock::now() - start).count());
+}
+
+static void run_benchmark(size_t num_pages, const std::vector<size_t>& pids_seed)
+{
+  std::vector<size_t> pids(pids_seed.size());
+  for (size_t i = 0; i < pids.size(); i++)
+  {
+    pids[i] = pids_seed[i] % num_pages;
+  }
+
+  // Legacy hash map
+  double map_ns;
+  uint64_t map_sum = 0;
+  {
+    boost::unordered_map<size_t, LegacyPageTableEntry> table;
+    for (size_t i = 0; i < num_pages; i++)
+    {
+      table.emplace(std::piecewise_construct, std::forward_as_tuple(i),
+        std::forward_as_tuple(nullptr, static_cast<PageLayer>(i % 3)));
+    }
+
+    auto start = boost::chrono::steady_clock::now();
+    for (size_t pid : pids)
+    {
+      auto it = table.find(pid);
+      const LegacyPageMetadata& meta = it->second.metadata;
+      map_sum += static_cast<uint64_t>(meta.page_layer.load(std::memory_order_relaxed)) +
+        meta.last_access_time_ms.load(std::memory_order_relaxed) +
+        meta.access_cnt.load(std::memory_order_relaxed);
+    }
+    map_ns = elapsed_ns(start) / pids.size();
+  }
+
+  // Dense structure-of-arrays
+  double soa_ns;
+  uint64_t soa_sum = 0;
+  {
+    PageMetadataArray metadata(num_pages);
+    for (size_t i = 0; i < num_pages; i++)
+    {
+      metadata.setLayer(i, static_cast<PageLayer>(i % 3));
+    }
+
+    uint64_t now_ms = PageMetadataArray::nowMs();
+    auto start = boost::chrono::steady_clock::now();
+    for (size_t pid : pids)
+    {
+      soa_sum += static_cast<uint64_t>(metadata.layer(pid)) +
+        metadata.lastAccessTimeMs(pid) + metadata.accessCount(pid, now_ms);
+    }
+    soa_ns = elapsed_ns(start) / pids.size();
+  }
+
+  // Hash node: key + entry + next pointer, plus one bucket pointer
+  size_t map_bytes = sizeof(size_t) + sizeof(LegacyPageTableEntry) + 2 * sizeof(void*);
+  size_t soa_bytes = PageMetadataArray::bytesPerPage() + sizeof(void*);
+
+  printf("%-10zu %-14.2f %-14.2f %-14zu %-14zu (checksum %llu/%llu)\n", num_pages,
+    map_ns, soa_ns, map_bytes, soa_bytes, (unsigned long long)map_sum,
+    (unsigned long long)soa_sum);
+}
+
+int main()
+{
+  std::mt19937_64 rng(42);
+  std::vector<size_t> pids(LOOKUPS);
+  for (size_t& pid : pids)
+  {
+    pid = rng();
+  }
+
+  printf("%-10s %-14s %-14s %-14s %-14s\n", "Pages", "Map(ns/op)", "SoA(ns/op)",
+    "Map(B/page)", "SoA(B/page)");
+  run_benchmark(1UL << 20, pids);
+  run_benchmark(1UL << 24, pids);
+  return 0;
+}
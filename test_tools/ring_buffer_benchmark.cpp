@@ -0,0 +1,122 @@
+// Request queue throughput benchmark: mutex ring vs lock-free MPSC/SPSC.
+//
+// N producer threads push ClientMessages, one consumer pops them all, as
+// Client::run() and the server manager thread do. Reports messages/sec for
+// 1 to 64 producers.
+
+#include <boost/chrono.hpp>
+#include <boost/circular_buffer.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "RingBuffer.hpp"
+
+#define TOTAL_MESSAGES (1 << 21)
+#define BUFFER_SIZE 1024
+
+// Ring buffer implementation before the lock-free rewrite
+template <typename T> class MutexRingBuffer {
+public:
+  MutexRingBuffer(size_t capacity) : buf_(capacity) {}
+
+  bool push(const T& item) {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    if (buf_.full()) {
+      return false;
+    }
+    buf_.push_back(item);
+    return true;
+  }
+
+  bool pop(T& item) {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    if (buf_.empty()) {
+      return false;
+    }
+    item = buf_.front();
+    buf_.pop_front();
+    return true;
+  }
+
+private:
+  boost::circular_buffer<T> buf_;
+  boost::mutex mutex_;
+};
+
+// Producers push into queues[i % queues.size()], consumer drains all queues
+template <typename Queue>
+static double run_benchmark(std::vector<Queue*>& queues, size_t num_producers)
+{
+  size_t per_producer = TOTAL_MESSAGES / num_producers;
+  size_t total = per_producer * num_producers;
+
+  auto start = boost::chrono::steady_clock::now();
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < num_producers; p++) {
+    producers.emplace_back([&queues, p, per_producer]() {
+      Queue* queue = queues[p % queues.size()];
+      for (size_t i = 0; i < per_producer; i++) {
+        ClientMessage msg(p, i, 0, OperationType::READ);
+        while (!queue->push(msg)) {
+          std::this_thread::yield();
+        }
+      }
+      });
+  }
+
+  size_t received = 0;
+  ClientMessage msg(0, 0, 0, OperationType::READ);
+  while (received < total) {
+    bool didwork = false;
+    for (Queue* queue : queues) {
+      if (queue->pop(msg)) {
+        received++;
+        didwork = true;
+      }
+    }
+    if (!didwork) {
+      std::this_thread::yield();
+    }
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+
+  double seconds = boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+    boost::chrono::steady_clock::now() - start).count() / 1e9;
+  return total / seconds;
+}
+
+int main()
+{
+  printf("%-10s %-16s %-16s %-16s\n", "Producers", "Mutex(msg/s)",
+    "MPSC(msg/s)", "SPSC(msg/s)");
+
+  for (size_t producers = 1; producers <= 64; producers *= 2) {
+    MutexRingBuffer<ClientMessage> mutex_queue(BUFFER_SIZE);
+    std::vector<MutexRingBuffer<ClientMessage>*> mutex_queues = { &mutex_queue };
+    double mutex_rate = run_benchmark(mutex_queues, producers);
+
+    RingBuffer<ClientMessage> mpsc_queue(BUFFER_SIZE, RingBufferMode::MPSC);
+    std::vector<RingBuffer<ClientMessage>*> mpsc_queues = { &mpsc_queue };
+    double mpsc_rate = run_benchmark(mpsc_queues, producers);
+
+    std::vector<std::unique_ptr<RingBuffer<ClientMessage>>> spsc_storage;
+    std::vector<RingBuffer<ClientMessage>*> spsc_queues;
+    for (size_t i = 0; i < producers; i++) {
+      spsc_storage.push_back(std::make_unique<RingBuffer<ClientMessage>>(
+        BUFFER_SIZE, RingBufferMode::SPSC));
+      spsc_queues.push_back(spsc_storage.back().get());
+    }
+    double spsc_rate = run_benchmark(spsc_queues, producers);
+
+    printf("%-10zu %-16.0f %-16.0f %-16.0f\n", producers, mutex_rate,
+      mpsc_rate, spsc_rate);
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+// Zipfian sampling benchmark: discrete_distribution table vs rejection-inversion.
+//
+// Compares setup time, memory and per-draw cost of the per-page probability
+// table the generator used before against ZipfianSampler, and checks that
+// the sampler's top ranks match the exact Zipf probabilities.
+
+#include <boost/chrono.hpp>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Generator.hpp"
+
+#define PAGES 1700000
+#define DRAWS 10000000
+#define TOP_RANKS 5
+
+static double elapsed_ns(boost::chrono::steady_clock::time_point start)
+{
+  return static_cast<double>(boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+    boost::chrono::steady_clock::now() - start).count());
+}
+
+int main()
+{
+  for (double s : { 0.99, 1.2 })
+  {
+    printf("Zipf n=%d s=%.2f\n", PAGES, s);
+
+    // Table based generator used before
+    Xoshiro256 rng(42);
+    auto start = boost::chrono::steady_clock::now();
+    std::vector<double> probabilities(PAGES);
+    for (size_t i = 1; i <= PAGES; i++)
+    {
+      probabilities[i - 1] = 1.0 / std::pow(i, s);
+    }
+    std::discrete_distribution<size_t> table(probabilities.begin(), probabilities.end());
+    double table_setup_ms = elapsed_ns(start) / 1e6;
+
+    size_t sink = 0;
+    start = boost::chrono::steady_clock::now();
+    for (size_t i = 0; i < DRAWS; i++)
+    {
+      sink += table(rng);
+    }
+    double table_draw_ns = elapsed_ns(start) / DRAWS;
+
+    // Rejection-inversion sampler
+    start = boost::chrono::steady_clock::now();
+    ZipfianSampler sampler(PAGES, s);
+    double sampler_setup_ms = elapsed_ns(start) / 1e6;
+
+    std::vector<size_t> hits(TOP_RANKS, 0);
+    start = boost::chrono::steady_clock::now();
+    for (size_t i = 0; i < DRAWS; i++)
+    {
+      size_t rank = sampler(rng);
+      sink += rank;
+      if (rank < TOP_RANKS)
+      {
+        hits[rank]++;
+      }
+    }
+    double sampler_draw_ns = elapsed_ns(start) / DRAWS;
+
+    ScatterPermutation scatter(PAGES, 7);
+    start = boost::chrono::steady_clock::now();
+    for (size_t i = 0; i < DRAWS; i++)
+    {
+      sink += scatter(i % PAGES);
+    }
+    double scatter_ns = elapsed_ns(start) / DRAWS;
+
+    // The table keeps the weights plus the distribution's cumulative copy
+    printf("  %-10s setup %10.4f ms  memory %10zu B  draw %6.2f ns\n", "table",
+      table_setup_ms, 2 * PAGES * sizeof(double), table_draw_ns);
+    printf("  %-10s setup %10.4f ms  memory %10zu B  draw %6.2f ns (+%.2f ns scatter)\n",
+      "sampler", sampler_setup_ms, sizeof(ZipfianSampler) + sizeof(ScatterPermutation),
+      sampler_draw_ns, scatter_ns);
+
+    double harmonic = 0.0;
+    for (size_t i = 1; i <= PAGES; i++)
+    {
+      harmonic += 1.0 / std::pow(i, s);
+    }
+    printf("  %-6s %-10s %-10s\n", "Rank", "Exact", "Sampled");
+    for (size_t rank = 0; rank < TOP_RANKS; rank++)
+    {
+      printf("  %-6zu %-10.5f %-10.5f\n", rank, 1.0 / std::pow(rank + 1, s) / harmonic,
+        static_cast<double>(hits[rank]) / DRAWS);
+    }
+    printf("  (checksum %zu)\n", sink % 10);
+  }
+
+  // The scatter must be a bijection for any page count
+  for (size_t n : { 1, 2, 3, 1000, 1023, 1025, 65537 })
+  {
+    ScatterPermutation scatter(n, n);
+    std::vector<bool> seen(n, false);
+    for (size_t i = 0; i < n; i++)
+    {
+      size_t page = scatter(i);
+      if (page >= n || seen[page])
+      {
+        printf("Scatter is not a permutation for n=%zu\n", n);
+        return 1;
+      }
+      seen[page] = true;
+    }
+  }
+  printf("Scatter permutation check passed\n");
+  return 0;
+}